@@ -0,0 +1,269 @@
+/* ===========================================================================
+ * Checkpoint.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+
+#include "Checkpoint.h"
+using namespace std;
+
+#define CKPT_MAGIC   "FCDCKPT"
+#define CKPT_VERSION 9
+
+/* Layout of the checkpoint file: header, av[n], then for each community
+ * its stamp, the position of cmax in clist (-1 if none), its next member,
+ * number of members, internal edges and volume, the number of nodes and
+ * the nodes themselves, then the heap elements in heap order,
+ * then the deferred communities, then the number of merge log records, Q0
+ * and the records.
+ * Nodes and elements are stored as raw structs, so a checkpoint can only
+ * be resumed by a build with the same layout. */
+typedef struct ckheader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t node_size;
+  uint32_t element_size;
+  int32_t  phase;
+  uint64_t deferred;   // communities owed a heap entry
+  uint64_t src_size;   // size of the dataset
+  int64_t  src_mtime;  // modification time of the dataset, in ns
+  uint64_t n;
+  int64_t  m;
+  uint64_t merges;
+  double   elapsed;
+  double   sQ;
+  uint64_t clock;      // heap version
+  uint64_t heap_size;
+} CkptHeader;
+
+
+Checkpoint::Checkpoint(const string& file, uint64_t n, double t) {
+  path = file;
+  every = n;
+  seconds = t;
+  log = NULL;
+  phase = PHASE_MULTISTEP;
+  resumed = false;
+  merges = 0;
+  elapsed = 0;
+  m = 0;
+  last = 0;
+  probe = 0;
+  since = chrono::steady_clock::now();
+}
+
+
+/* [header] function:  due
+ * ----------------------------------------------------------------------------
+ * Check whether a checkpoint must be taken. The clock is only read every
+ * 1024 merges, to keep the check cheap.
+ *
+ * Args:
+ *    - done: merges done so far.
+ */
+bool Checkpoint::due(uint64_t done) {
+  if (every > 0 && done - last >= every) return true;
+  if (seconds > 0 && done - probe >= 1024) {
+    probe = done;
+    double t = chrono::duration<double>(chrono::steady_clock::now() - since).count();
+    if (t >= seconds) return true;
+  }
+  return false;
+}
+
+
+/* [header] function:  save
+ * ----------------------------------------------------------------------------
+ * Write the merge state to the checkpoint file. The state is written to a
+ * temporary file and renamed, so the previous checkpoint survives a crash
+ * during the write.
+ *
+ * Args:
+ *    - univ, av, h: state of the run.
+ *    - sQ:          partial Q.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool Checkpoint::save(vector<Community>& univ, vector<double>& av,
+                      MaxHeap& h, double sQ) {
+  CkptHeader hd;
+  memset(&hd, 0, sizeof(hd));
+  memcpy(hd.magic, CKPT_MAGIC, sizeof(CKPT_MAGIC));
+  hd.version = CKPT_VERSION;
+  hd.node_size = sizeof(CNode);
+  hd.element_size = sizeof(Element);
+  hd.phase = phase;
+  if (!source_info(source, hd.src_size, hd.src_mtime)) return false;
+  hd.n = univ.size();
+  hd.m = m;
+  hd.merges = merges;
+  hd.elapsed = elapsed;
+  hd.sQ = sQ;
+  hd.clock = h.now();
+  hd.heap_size = h.size();
+  hd.deferred = h.pending().size();
+
+  string tmpname = path + ".tmp";
+  ofstream out(tmpname, ios::binary);
+  if (!out.is_open()) return false;
+  out.write((const char*)&hd, sizeof(hd));
+  out.write((const char*)av.data(), av.size()*sizeof(double));
+  for (auto&& c: univ) {
+    int64_t cmax = -1, x = 0;
+    for (auto it=c.clist.begin(); it!=c.clist.end(); ++it, ++x)
+      if (&(*it) == c.cmax) cmax = x;
+    uint64_t count = c.clist.size();
+    out.write((const char*)&c.stamp, sizeof(c.stamp));
+    out.write((const char*)&cmax, sizeof(cmax));
+    out.write((const char*)&c.next, sizeof(c.next));
+    out.write((const char*)&c.msize, sizeof(c.msize));
+    out.write((const char*)&c.inner, sizeof(c.inner));
+    out.write((const char*)&c.volume, sizeof(c.volume));
+    out.write((const char*)&count, sizeof(count));
+#ifdef COMMUNITY_VECTOR
+    out.write((const char*)c.clist.data(), count*sizeof(CNode));
+#else
+    for (auto&& node: c.clist)
+      out.write((const char*)&node, sizeof(CNode));
+#endif
+  }
+  out.write((const char*)h.elements().data(), h.size()*sizeof(Element));
+  out.write((const char*)h.pending().data(), hd.deferred*sizeof(vid_t));
+  uint64_t count = (log != NULL) ? log->recs.size() : 0;
+  double Q0 = (log != NULL) ? log->Q0 : 0;
+  out.write((const char*)&count, sizeof(count));
+  out.write((const char*)&Q0, sizeof(Q0));
+  if (count > 0)
+    out.write((const char*)log->recs.data(), count*sizeof(MergeRec));
+  out.close();
+  if (!out) {
+    remove(tmpname.c_str());
+    return false;
+  }
+  if (rename(tmpname.c_str(), path.c_str()) != 0) return false;
+
+  last = merges;
+  probe = merges;
+  since = chrono::steady_clock::now();
+  return true;
+}
+
+
+/* [header] function:  load
+ * ----------------------------------------------------------------------------
+ * Restore the merge state from the checkpoint file. A checkpoint taken on
+ * another version of the dataset (size, modification time, vertices or
+ * edges differ) is refused.
+ *
+ * Args:
+ *    - g:           graph of the dataset.
+ *    - univ, av, h: empty state of the run.
+ *    - sQ:          partial Q.
+ *
+ * Returns: true if a valid checkpoint was restored, false otherwise.
+ */
+bool Checkpoint::load(const Graph& g, vector<Community>& univ,
+                      vector<double>& av, MaxHeap& h, double& sQ) {
+  ifstream in(path, ios::binary);
+  if (!in.is_open()) return false;
+  CkptHeader hd;
+  if (!in.read((char*)&hd, sizeof(hd))) return false;
+  if (memcmp(hd.magic, CKPT_MAGIC, sizeof(CKPT_MAGIC)) != 0 ||
+      hd.version != CKPT_VERSION || hd.node_size != sizeof(CNode) ||
+      hd.element_size != sizeof(Element))
+    return false;
+  uint64_t size;
+  int64_t mtime;
+  if (!source_info(source, size, mtime) || size != hd.src_size ||
+      mtime != hd.src_mtime || hd.n != uint64_t(g.n) || hd.m != g.m) {
+    cerr << "Checkpoint " << path << " is from another version of "
+         << source << ", not resumed\n";
+    return false;
+  }
+
+  univ.clear();
+  univ.resize(hd.n);
+  av.resize(hd.n);
+  in.read((char*)av.data(), hd.n*sizeof(double));
+  vector<CNode> nodes;
+  for (uint64_t x=0; x<hd.n; x++) {
+    Community& c = univ[x];
+    int64_t cmax;
+    uint64_t count;
+    c.id = x;
+    in.read((char*)&c.stamp, sizeof(c.stamp));
+    in.read((char*)&cmax, sizeof(cmax));
+    in.read((char*)&c.next, sizeof(c.next));
+    in.read((char*)&c.msize, sizeof(c.msize));
+    in.read((char*)&c.inner, sizeof(c.inner));
+    in.read((char*)&c.volume, sizeof(c.volume));
+    in.read((char*)&count, sizeof(count));
+    nodes.resize(count, CNode(0, 0, 0));
+    in.read((char*)nodes.data(), count*sizeof(CNode));
+    c.clist.assign(nodes.begin(), nodes.end());
+    c.cmax = NULL;
+    if (cmax >= 0) {
+      // the row is rebuilt from the restored clist and av
+      auto it = c.clist.begin();
+      advance(it, cmax);
+      c.scan_max(av);
+      c.cmax = &(*it);
+    }
+  }
+  vector<Element> e(hd.heap_size, Element(0, 0, 0, 0));
+  in.read((char*)e.data(), hd.heap_size*sizeof(Element));
+  vector<vid_t> dirty(hd.deferred);
+  in.read((char*)dirty.data(), hd.deferred*sizeof(vid_t));
+  uint64_t count;
+  double Q0;
+  in.read((char*)&count, sizeof(count));
+  in.read((char*)&Q0, sizeof(Q0));
+  if (!in || count >= hd.n + 1) return false;
+  if (log != NULL) {
+    log->reset(hd.n, Q0);
+    log->recs.resize(count);
+    in.read((char*)log->recs.data(), count*sizeof(MergeRec));
+    if (!in) return false;
+    if (count > 0) log->Q = log->recs.back().Q;
+  }
+  h.restore(e, hd.clock);
+  h.pending().swap(dirty);
+
+  phase = hd.phase;
+  merges = hd.merges;
+  elapsed = hd.elapsed;
+  m = hd.m;
+  sQ = hd.sQ;
+  resumed = true;
+  last = merges;
+  probe = merges;
+  since = chrono::steady_clock::now();
+  return true;
+}
+
+
+void Checkpoint::discard() {
+  remove(path.c_str());
+}
@@ -0,0 +1,77 @@
+/* ===========================================================================
+ * Checkpoint.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <string>
+#include <chrono>
+#include "Community.h"
+#include "MaxHeap.h"
+#include "MergeLog.h"
+#include "Graph.h"
+
+#define PHASE_MULTISTEP 0  // inside the multi-step rounds of cnm2
+#define PHASE_STANDARD  1  // inside cnm (alone or at the end of cnm2)
+
+/* ============================================================================
+ * Checkpoint saves the whole merge state of a run (universe, av, heap,
+ * partial Q and merge counters) to a binary file every given number of
+ * merges or seconds, and restores it to resume the run. The merge log of
+ * the run, if any, is saved along with it. A resumed run
+ * produces the same result of an uninterrupted one.
+ * ============================================================================
+ */
+
+class Checkpoint {
+
+public:
+  std::string path;     // checkpoint file
+  std::string source;   // dataset of the run, a checkpoint of another
+                        // version of it is not resumed
+  uint64_t    every;    // merges between two checkpoints, 0 to disable
+  double      seconds;  // seconds between two checkpoints, 0 to disable
+  MergeLog*   log;      // merge log of the run, or NULL
+
+  // state of the run, kept up to date by cnm and cnm2
+  int         phase;    // PHASE_MULTISTEP or PHASE_STANDARD
+  bool        resumed;  // state was restored from a checkpoint
+  uint64_t    merges;   // merges done so far
+  double      elapsed;  // algorithm time before the current call
+  eid_t       m;        // number of edges
+
+  Checkpoint(const std::string&, uint64_t, double);
+
+  bool due(uint64_t);   // true if a checkpoint must be taken now
+  bool save(std::vector<Community>&, std::vector<double>&, MaxHeap&, double);
+  bool load(const Graph&, std::vector<Community>&, std::vector<double>&,
+            MaxHeap&, double&);
+  void discard();       // remove the checkpoint of a completed run
+
+private:
+  uint64_t last;        // merges at the last checkpoint
+  uint64_t probe;       // merges at the last clock reading
+  std::chrono::steady_clock::time_point since;  // time of last checkpoint
+};
+
+#endif // __CHECKPOINT_H
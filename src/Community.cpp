@@ -22,16 +22,27 @@
  */
 
 #include "Community.h"
+#include "Kernels.h"
+#include "Stats.h"
+#include "Perf.h"
 using namespace std;
 
 
 Community::Community() {
   id = -1;
+  next = -1;
+  msize = 1;
+  inner = 0;
+  volume = 0;
   stamp = 0;
 }
 
-Community::Community(int idx) {
+Community::Community(vid_t idx) {
   id = idx;
+  next = idx;
+  msize = 1;
+  inner = 0;
+  volume = 0;
   stamp = 0;
 }
 
@@ -49,25 +60,7 @@ ostream& operator <<(ostream& os, Community& c) {
 }
 
 
-unsigned int Community::degree() {
-  unsigned int cnt = 0;
-  for (auto it=clist.begin(); it!=clist.end(); ++it)
-    if (!it->member)
-      cnt++;
-  return cnt;
-}
-
-
-unsigned int Community::members() {
-  unsigned int cnt = 0;
-  for (auto it=clist.begin(); it!=clist.end(); ++it)
-    if (it->member)
-      cnt++;
-  return cnt;
-}
-
-
-bool Community::contains(int k) {
+bool Community::contains(vid_t k) {
   for (auto it=clist.begin(); it!=clist.end(); ++it)
     if (it->k == k)
       return true;
@@ -75,44 +68,73 @@ bool Community::contains(int k) {
 }
 
 
-bool Community::add(int k, double v, bool f) {
+bool Community::add(vid_t k, double v, wgt_t w) {
   for (auto it=clist.begin(); it!=clist.end(); ++it) {
     if (it->k > k) {
-      clist.emplace(it, k, v, f);
+      clist.emplace(it, k, v, w);
       return true;
     }
     if (it->k == k) return false;
   }
-  clist.push_back(CNode(k, v, f));
+  clist.push_back(CNode(k, v, w));
   return true;
 }
 
 
 /* [header] function:  scan_max
  * ----------------------------------------------------------------------------
- * Scan the community neighborhood to find the member with maximum 
- * delta Q value.
+ * Scan the community neighborhood to find the neighbor with maximum
+ * delta Q value, and rebuild the row heap of the neighbors with positive
+ * delta Q.
  *
  * Args:
  *    - av : vector of double.
  *
- * Returns: 1 if new maximum is found, 0 if same value, -1 if invalid. 
+ * Returns: true if a neighbor with positive delta Q exists, false otherwise.
  */
 bool Community::scan_max(vector<double>& av) {
-  cmax = NULL;
-  double bestdq = 0;
-  for (list<CNode>::iterator it=clist.begin(); it!=clist.end(); ++it) {
-    if (!(it->member) && (av[it->k] > 0) && (it->dq > bestdq)) {
-        bestdq = it->dq;
-        cmax = &(*it);  
-    }
+  PerfRegion perf(R_SCAN);
+  stats_count(C_SCANNED, clist.size());
+#ifdef COMMUNITY_VECTOR
+  row.resize(clist.size());
+  row.resize(select_candidates(clist.data(), clist.size(), av.data(),
+                               row.data()));
+#else
+  row.clear();
+  for (CList::iterator it=clist.begin(); it!=clist.end(); ++it)
+    if ((av[it->k] > 0) && (it->dq > 0))
+      row.push_back(&(*it));
+#endif
+  make_heap(row.begin(), row.end(), RowOrder());
+  cmax = row.empty() ? NULL : row.front();
+  return (cmax != NULL);
+}
+
+
+/* [header] function:  update_max
+ * ----------------------------------------------------------------------------
+ * Pop from the row heap the neighbors absorbed since the last scan. The
+ * delta Q values of the row only change when the community itself merges,
+ * which rebuilds the row, so the new top is the maximum a full scan would
+ * find.
+ *
+ * Args:
+ *    - av : vector of double.
+ *
+ * Returns: true if a neighbor with positive delta Q exists, false otherwise.
+ */
+bool Community::update_max(vector<double>& av) {
+  while (!row.empty() && av[row.front()->k] <= 0) {
+    pop_heap(row.begin(), row.end(), RowOrder());
+    row.pop_back();
   }
+  cmax = row.empty() ? NULL : row.front();
   return (cmax != NULL);
 }
 
 
-bool Community::remove(int k) {
-  for (list<CNode>::iterator it=clist.begin(); it!=clist.end(); ++it) {
+bool Community::remove(vid_t k) {
+  for (CList::iterator it=clist.begin(); it!=clist.end(); ++it) {
     if (it->k == k) {
       it = clist.erase(it);
       return true;        
@@ -122,61 +144,171 @@ bool Community::remove(int k) {
 }
 
 
+void Community::sort() {
+#ifdef COMMUNITY_VECTOR
+  std::sort(clist.begin(), clist.end());
+#else
+  clist.sort();
+#endif
+}
+
+
 void Community::shrink(vector<double>& av) {  
-  for (list<CNode>::iterator it=clist.begin(); it!=clist.end();)
-    if ((!it->member) && (av[it->k] < 0))
-      it = clist.erase(it);
-    else ++it;
+  clist.erase(remove_if(clist.begin(), clist.end(),
+                        [&av](const CNode& n) {return av[n.k] < 0;}),
+              clist.end());
+}
+
+
+/* [header] function:  link
+ * ----------------------------------------------------------------------------
+ * Concatenate the member chain of c to this one, and add up the counters.
+ * Both chains are circular, so swapping the two successors joins them in a
+ * single ring. The edges between the two communities are not known here,
+ * the caller adds them to inner.
+ *
+ * Args:
+ *    - c: community whose members are taken over, left with none.
+ */
+void Community::link(Community& c) {
+  std::swap(next, c.next);
+  msize += c.msize;
+  inner += c.inner;
+  volume += c.volume;
+  c.msize = 0;
+  c.inner = 0;
+  c.volume = 0;
 }
 
 
+#ifndef COMMUNITY_VECTOR
 void Community::merge(Community& cm, vector<double>& av) {
-  list<CNode>::iterator ax = clist.begin();
-  list<CNode>::iterator bx = cm.clist.begin();
-  while (1) {
-    if (ax == clist.end()) {
-      // update from bx to by, equation (10b)
-      for (; bx!=cm.clist.end(); ++bx)
-        bx->dq -= 2.0*av[id]*av[bx->k];
-      // append the remaining b list to a
-      clist.splice(ax, cm.clist);      
-      break;
+  PerfRegion perf(R_MERGE);
+  size_t before = clist.size();
+  size_t internal = 0;  // edges to cm dropped
+  eid_t cut = 0;        // edges to cm, now internal
+  // Nodes of absorbed communities keep their old id. The ones that lead to
+  // cm or to this community are edges inside the merged one: they are
+  // dropped, and those of this side that lead to cm count in inner.
+  auto inside = [&](const CNode& x, bool mine) {
+    vid_t r = (av[x.k] < 0) ? owner(x.k, av) : x.k;
+    if (mine && r == cm.id) cut += x.w;
+    return r == cm.id || r == id;
+  };
+  CList::iterator ax = clist.begin();
+  CList::iterator bx = cm.clist.begin();
+  while (ax != clist.end() || bx != cm.clist.end()) {
+    if (ax != clist.end() && inside(*ax, true)) {
+      ax = clist.erase(ax);
+      internal++;
+      continue;
     }
-
-    if (bx == cm.clist.end()) {
-      // update from ax to ay, equation (10c)
-      for (;ax!=clist.end(); ++ax)
-        if (ax->k == cm.id)
-          ax->member = true;
-        else 
-          ax->dq -= 2.0*av[cm.id]*av[ax->k];
-      break;
+    if (bx != cm.clist.end() && inside(*bx, false)) {
+      bx = cm.clist.erase(bx);
+      continue;
     }
 
-    if (ax->k == cm.id)
-      ax->member = true;
-
-    if (ax->k < bx->k) {
+    if (bx == cm.clist.end() || (ax != clist.end() && ax->k < bx->k)) {
       // update ax, equation (10c)
       ax->dq -= 2.0*av[cm.id]*av[ax->k];
       ++ax;
-    } else if (ax->k > bx->k) {
+    } else if (ax == clist.end() || ax->k > bx->k) {
       // update bx, equation (10b)
       bx->dq -= 2.0*av[id]*av[bx->k];
       // transfer the node from list b to a
       clist.splice(ax, cm.clist, bx);
       bx = cm.clist.begin();
     } else {  // equals
-      // check if members
-      // or update ax, equation (10a)
-      if (bx->member)
-        ax->member = true;
-      else
-        ax->dq += bx->dq;      
+      // update ax, equation (10a)
+      ax->dq += bx->dq;
+      ax->w += bx->w;
       ++ax;
       // remove equal node from b
       cm.clist.pop_front();
       bx = cm.clist.begin();
     }
   }
+  inner += cut;
+  link(cm);
+  stats_count(C_SPLICES, clist.size() + internal - before);
+}
+
+#else
+/* [header] function:  merge (contiguous backend)
+ * ----------------------------------------------------------------------------
+ * Same update rules of the list version, equations (10a), (10b) and (10c),
+ * but both sorted arrays are merged in a single linear pass into a new
+ * array, which then replaces the current one. Nodes copied in a row from
+ * the same side take the same update, so (10b) and (10c) are applied by
+ * run with subtract_run.
+ *
+ * Args:
+ *    - cm: community to be absorbed, left empty.
+ *    - av: vector of double.
+ */
+void Community::merge(Community& cm, vector<double>& av) {
+  PerfRegion perf(R_MERGE);
+  const double ca = 2.0*av[id];
+  const double cb = 2.0*av[cm.id];
+  size_t before = clist.size();
+  size_t internal = 0;  // edges to cm dropped
+  eid_t cut = 0;        // edges to cm, now internal
+  // nodes of absorbed communities, see the list version
+  auto inside = [&](const CNode& x, bool mine) {
+    vid_t r = (av[x.k] < 0) ? owner(x.k, av) : x.k;
+    if (mine && r == cm.id) cut += x.w;
+    return r == cm.id || r == id;
+  };
+  CList out;
+  out.reserve(clist.size() + cm.clist.size());
+
+  // out[start..] is the pending run and c its coefficient, 0 for none
+  size_t start = 0;
+  double c = 0;
+  auto run = [&](double next) {
+    if (next == c) return;
+    if (c != 0)
+      subtract_run(out.data() + start, out.size() - start, c, av.data());
+    start = out.size();
+    c = next;
+  };
+
+  CList::iterator ax = clist.begin();
+  CList::iterator bx = cm.clist.begin();
+  while (ax != clist.end() || bx != cm.clist.end()) {
+    if (ax != clist.end() && inside(*ax, true)) {
+      ++ax;
+      internal++;
+      continue;
+    }
+    if (bx != cm.clist.end() && inside(*bx, false)) {
+      ++bx;
+      continue;
+    }
+
+    if (bx == cm.clist.end() || (ax != clist.end() && ax->k < bx->k)) {
+      // update ax, equation (10c)
+      run(cb);
+      out.push_back(*ax++);
+    } else if (ax == clist.end() || ax->k > bx->k) {
+      // update bx, equation (10b)
+      run(ca);
+      out.push_back(*bx++);
+    } else {  // equals
+      // update ax, equation (10a)
+      run(0);
+      ax->dq += bx->dq;
+      ax->w += bx->w;
+      out.push_back(*ax++);
+      ++bx;
+    }
+  }
+  run(0);
+
+  clist.swap(out);
+  CList().swap(cm.clist);  // release the absorbed storage
+  inner += cut;
+  link(cm);
+  stats_count(C_SPLICES, clist.size() + internal - before);
 }
+#endif
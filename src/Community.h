@@ -26,61 +26,114 @@
 #define __COMMUNITY_H
 
 #include <list>
-#include <chrono>
+#include <cstdint>
+#include <algorithm>
 #include <vector>
 #include <iostream>
+#include "Pool.h"
+#include "Types.h"
 
 
+/* A neighbor k of a community, with the delta Q of their merge and the
+ * number w of edges between them. */
 typedef struct node {
-  double dq;
-  int    k;
-  bool   member;
+  dq_t     dq;
+  vid_t    k;
+  wgt_t    w;
 
-  node(int a, double b, bool c): k(a), dq(b), member(c) {}
+  node(vid_t a, dq_t b, wgt_t c): dq(b), k(a), w(c) {}
   ~node() {}
   inline bool operator <(const node& n) const {return k<n.k;}
   inline bool operator ==(const node& n) const {return k==n.k;}
-} CNode;  // 16B
+} CNode;  // 16B (24B with 64-bit ids, 12B compact)
+
+/* Storage backend of the community neighborhood, chosen at build time.
+ * By default a sorted std::list whose nodes come from a SlabPool; compile with
+ * -DCOMMUNITY_VECTOR (make STORAGE=vector) for a sorted contiguous array,
+ * merged with a single linear pass. */
+#ifdef COMMUNITY_VECTOR
+typedef std::vector<CNode> CList;
+#else
+typedef std::list<CNode, PoolAllocator<CNode>> CList;
+#endif
+
+/* av of a community absorbed by owner. It is strictly negative, so that it
+ * is never taken for the 0 of an isolated vertex (owner 0 included). */
+inline double absorbed(vid_t owner) {return -(double(owner) + 1);}
+inline vid_t  owner_of(double a) {return vid_t(-a) - 1;}
+
+/* Live community of k, following the owners of the absorbed ones. The
+ * chain is compressed on the way back, each community on it is pointed at
+ * the live one, so that the next lookup takes a single step. */
+inline vid_t owner(vid_t k, std::vector<double>& av) {
+  vid_t r = k;
+  while (av[r] < 0) r = owner_of(av[r]);
+  while (av[k] < 0 && owner_of(av[k]) != r) {
+    vid_t up = owner_of(av[k]);
+    av[k] = absorbed(r);
+    k = up;
+  }
+  return r;
+}
+
+/* Order of the row heap: larger dQ first and, on ties, the lower id, i.e.
+ * the node a linear scan of the sorted clist would pick. */
+struct RowOrder {
+  inline bool operator ()(const CNode* a, const CNode* b) const {
+    if (a->dq != b->dq) return a->dq < b->dq;
+    return a->k > b->k;
+  }
+};
 
 /* ============================================================================
  * Community class represent a single community in the "community universe".
  * Each community maintains a list of its neighbors and a pointer to the
- * maximum delta Q value.
+ * maximum delta Q value. The neighbors with positive delta Q are also kept
+ * in a binary max-heap (row), so that when the maximum neighbor is absorbed
+ * by another community the next one is found in O(log d), without a scan.
+ * The members of a community are chained in a circular list through next,
+ * starting from the community itself, so that a merge concatenates them in
+ * O(1), touching the two communities only. Member count, internal edges
+ * and volume are counters kept up to date by merge.
  * ============================================================================
  */
 
 class Community {
 
 public:
-  std::list<CNode> clist;  // list of members
+  CList       clist;  // list of neighbors
   CNode*      cmax;   // maximum dQ
-  uint64_t    stamp;  // timestamp of last cmax
-  int         id;     // community id
+  std::vector<CNode*> row;  // heap of candidate neighbors, top is cmax
+  uint64_t    stamp;  // version of last cmax
+  vid_t       id;     // community id
+  vid_t       next;   // next member in the chain of the owner
+  vid_t       msize;  // number of members, 0 once absorbed
+  eid_t       inner;  // edges between members
+  eid_t       volume; // sum of the degrees of members
   
   Community();     // default constructor (for vector allocation)
-  Community(int);  // custom constructor
+  Community(vid_t);  // custom constructor
   ~Community();    // default deconstructor
 
   friend std::ostream& operator <<(std::ostream&, Community&);
 
-  inline unsigned int size() {return clist.size();}
+  inline size_t size() {return clist.size();}
 
-  unsigned int degree();
-  unsigned int members();
+  inline size_t degree() {return clist.size();}
+  inline size_t members() {return msize;}
+  inline eid_t  boundary() {return volume - 2*inner;}  // edges leaving
 
-  bool contains(int);
-  bool add(int,double,bool);            // Add node in community
-  bool scan_max(std::vector<double>&);  // Find member with maximum dQ
-  bool remove(int);                     // Remove specific node
+  bool contains(vid_t);
+  bool add(vid_t,double,wgt_t);         // Add node in community
+  bool scan_max(std::vector<double>&);  // Find neighbor with maximum dQ
+  bool update_max(std::vector<double>&);  // Drop absorbed neighbors from top
+  bool remove(vid_t);                   // Remove specific node
+  void sort();                          // Sort nodes by id
 
   void shrink(std::vector<double>&);            // Remove obsolete nodes
   void merge(Community&,std::vector<double>&);  // Merge two communities
+  void link(Community&);                        // Take over the members
 
-};  // 48B
-
-inline uint64_t timestamp() {
-    return std::chrono::duration_cast<std::chrono::microseconds>
-              (std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-}
+};  // 96B
 
 #endif // __COMMUNITY_H
\ No newline at end of file
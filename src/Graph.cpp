@@ -0,0 +1,468 @@
+/* ===========================================================================
+ * Graph.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Graph.h"
+using namespace std;
+
+#define CACHE_MAGIC   "FCDCSR"
+#define CACHE_VERSION 2
+
+/* Layout of the cache file: header, offsets[n+1] as uint64, adj[entries]
+ * as vid_t. The header is 64 bytes, so both arrays are naturally aligned
+ * in the mapping. */
+typedef struct header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t width;      // sizeof(vid_t) of the neighbors array
+  uint64_t src_size;   // size of the source file
+  int64_t  src_mtime;  // modification time of the source file, in ns
+  uint64_t n;
+  uint64_t m;
+  uint64_t entries;    // offsets[n]
+  uint64_t checksum;   // checksum of offsets and adj
+} CacheHeader;  // 64B
+
+
+Graph::Graph() {
+  n = 0;
+  m = 0;
+  offsets = NULL;
+  adj = NULL;
+  region = NULL;
+  length = 0;
+}
+
+Graph::~Graph() {
+  release();
+}
+
+
+/* [header] function:  cache_name
+ * ----------------------------------------------------------------------------
+ * Name of the binary cache associated to a source edge list.
+ */
+string cache_name(const string& filename) {
+  return filename + "_preprocess.bin";
+}
+
+
+/* [header] function:  max_threads
+ * ----------------------------------------------------------------------------
+ * Number of threads available to the parallel sections, 1 if the program
+ * is built without OpenMP.
+ */
+int max_threads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+
+/* [header] function:  source_info
+ * ----------------------------------------------------------------------------
+ * Size and modification time (in ns) of a source file, that bind the files
+ * derived from it (cache, checkpoints) to its current version.
+ *
+ * Returns: false if the file cannot be read.
+ */
+bool source_info(const string& filename, uint64_t& size, int64_t& mtime) {
+  struct stat buf;
+  if (stat(filename.c_str(), &buf) != 0) return false;
+  size = buf.st_size;
+  mtime = int64_t(buf.st_mtim.tv_sec)*1000000000 + buf.st_mtim.tv_nsec;
+  return true;
+}
+
+
+static uint64_t checksum(const void* data, size_t bytes, uint64_t h) {
+  const uint64_t* w = (const uint64_t*)data;
+  size_t words = bytes / 8;
+  for (size_t i=0; i<words; i++)
+    h = (h ^ w[i]) * 0x100000001b3ULL;
+  const unsigned char* c = (const unsigned char*)(w + words);
+  for (size_t i=0; i<bytes%8; i++)
+    h = (h ^ c[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+
+void Graph::assign(vector<uint64_t>& off, vector<vid_t>& nbr) {
+  release();
+  own_offsets.swap(off);
+  own_adj.swap(nbr);
+  n = own_offsets.size() - 1;
+  offsets = own_offsets.data();
+  adj = own_adj.data();
+  m = offsets[n] / 2;
+}
+
+
+/* Borrow CSR arrays of n vertices, which must outlive the graph. */
+void Graph::view(vid_t nv, const uint64_t* off, const vid_t* nbr) {
+  release();
+  n = nv;
+  offsets = off;
+  adj = nbr;
+  m = offsets[n] / 2;
+}
+
+
+void Graph::release() {
+  if (region != NULL)
+    munmap(region, length);
+  region = NULL;
+  length = 0;
+  vector<uint64_t>().swap(own_offsets);
+  vector<vid_t>().swap(own_adj);
+  offsets = NULL;
+  adj = NULL;
+  n = 0;
+  m = 0;
+}
+
+
+/* [header] function:  load_cache
+ * ----------------------------------------------------------------------------
+ * Map the binary cache of a source file. The cache is rejected if it has a
+ * different version, if the source file changed in size or modification
+ * time since the cache was written, or if the checksum does not match.
+ *
+ * Args:
+ *    - filename: source edge list (not the cache itself).
+ *
+ * Returns: true if the graph is now mapped from the cache, false otherwise.
+ */
+bool Graph::load_cache(const string& filename) {
+  uint64_t size;
+  int64_t mtime;
+  if (!source_info(filename, size, mtime)) return false;
+
+  int fd = open(cache_name(filename).c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat buf;
+  if (fstat(fd, &buf) != 0 || buf.st_size < sizeof(CacheHeader)) {
+    close(fd);
+    return false;
+  }
+  void* p = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return false;
+
+  const CacheHeader* h = (const CacheHeader*)p;
+  size_t expected = sizeof(CacheHeader) + (h->n+1)*sizeof(uint64_t)
+                    + h->entries*sizeof(vid_t);
+  if (memcmp(h->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      h->version != CACHE_VERSION || h->width != sizeof(vid_t) ||
+      h->src_size != size || h->src_mtime != mtime ||
+      expected != size_t(buf.st_size)) {
+    munmap(p, buf.st_size);
+    return false;
+  }
+
+  const uint64_t* off = (const uint64_t*)(h+1);
+  const vid_t* nbr = (const vid_t*)(off + h->n+1);
+  uint64_t sum = checksum(off, (h->n+1)*sizeof(uint64_t), 0xcbf29ce484222325ULL);
+  sum = checksum(nbr, h->entries*sizeof(vid_t), sum);
+  if (sum != h->checksum || off[h->n] != h->entries) {
+    munmap(p, buf.st_size);
+    return false;
+  }
+
+  release();
+  region = p;
+  length = buf.st_size;
+  n = h->n;
+  m = h->m;
+  offsets = off;
+  adj = nbr;
+  return true;
+}
+
+
+/* [header] function:  save_cache
+ * ----------------------------------------------------------------------------
+ * Write the binary cache of a source file. The cache is written to a
+ * temporary file and renamed, so a crash never leaves a truncated cache.
+ *
+ * Args:
+ *    - filename: source edge list (not the cache itself).
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool Graph::save_cache(const string& filename) const {
+  CacheHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  h.version = CACHE_VERSION;
+  h.width = sizeof(vid_t);
+  if (!source_info(filename, h.src_size, h.src_mtime)) return false;
+  h.n = n;
+  h.m = m;
+  h.entries = offsets[n];
+  h.checksum = checksum(offsets, (h.n+1)*sizeof(uint64_t), 0xcbf29ce484222325ULL);
+  h.checksum = checksum(adj, h.entries*sizeof(vid_t), h.checksum);
+
+  string tmpname = cache_name(filename) + ".tmp";
+  ofstream outfile(tmpname, ios::binary);
+  if (!outfile.is_open()) return false;
+  outfile.write((const char*)&h, sizeof(h));
+  outfile.write((const char*)offsets, (h.n+1)*sizeof(uint64_t));
+  outfile.write((const char*)adj, h.entries*sizeof(vid_t));
+  outfile.close();
+  if (!outfile) {
+    remove(tmpname.c_str());
+    return false;
+  }
+  return rename(tmpname.c_str(), cache_name(filename).c_str()) == 0;
+}
+
+
+/* [] function:  parse_chunk
+ * ----------------------------------------------------------------------------
+ * Parse the lines in [p, end) of an edge list. The first two integers of
+ * each line are an edge, anything else on the line is ignored; lines not
+ * starting with a digit (comments, headers) are skipped.
+ *
+ * Args:
+ *    - p, end: chunk of the file, starting at the beginning of a line.
+ *    - edges:  output vector of pairs, stored flat.
+ *    - maxid:  maximal id seen in the chunk.
+ *
+ * Returns: false if an id does not fit in a vid_t, true otherwise.
+ */
+static bool parse_chunk(const char* p, const char* end,
+                        vector<vid_t>& edges, vid_t& maxid) {
+  int64_t x[2];
+  while (p < end) {
+    while (p < end && (*p==' ' || *p=='\t' || *p=='\r' || *p=='\n')) p++;
+    if (p >= end) break;
+
+    int c = 0;
+    while (c < 2 && p < end && *p >= '0' && *p <= '9') {
+      int64_t v = 0;
+      while (p < end && *p >= '0' && *p <= '9') {
+        int d = *p++ - '0';
+        if (v > (VID_MAX - 1 - d) / 10) return false;
+        v = v*10 + d;
+      }
+      x[c++] = v;
+      while (p < end && (*p==' ' || *p=='\t')) p++;
+    }
+    if (c == 2 && x[0] != x[1]) {  // self-loops are dropped
+      edges.push_back(x[0]);
+      edges.push_back(x[1]);
+      maxid = max(maxid, vid_t(max(x[0], x[1])));
+    }
+    while (p < end && *p != '\n') p++;  // rest of the line
+  }
+  return true;
+}
+
+
+/* [header] function:  read_edge_list
+ * ----------------------------------------------------------------------------
+ * Build the graph from a text edge list in a single pass. The file is
+ * mapped and split in one chunk per thread on line boundaries, chunks are
+ * parsed in parallel and the adjacency is built with a count, prefix-sum,
+ * fill and per-row sort/unique pipeline. The graph is made undirected and
+ * self-loops and multi-edges are removed.
+ *
+ * Args:
+ *    - filename: trivial.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool Graph::read_edge_list(const string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat buf;
+  if (fstat(fd, &buf) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = buf.st_size;
+  const char* text = NULL;
+  if (size > 0) {
+    void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    madvise(p, size, MADV_SEQUENTIAL);
+    text = (const char*)p;
+  }
+  close(fd);
+
+  // split the file on line boundaries
+  int T = max_threads();
+  vector<size_t> bounds(T+1, size);
+  bounds[0] = 0;
+  for (int t=1; t<T; t++) {
+    size_t b = max(bounds[t-1], size*t/T);
+    while (b < size && b > 0 && text[b-1] != '\n') b++;
+    bounds[t] = b;
+  }
+
+  // parse
+  vector<vector<vid_t>> edges(T);
+  vector<vid_t> maxid(T, -1);
+  bool ok = true;
+  #pragma omp parallel for schedule(static,1) reduction(&&:ok)
+  for (int t=0; t<T; t++) {
+    edges[t].reserve((bounds[t+1]-bounds[t])/6);
+    ok = parse_chunk(text+bounds[t], text+bounds[t+1], edges[t], maxid[t]);
+  }
+  if (text != NULL) munmap((void*)text, size);
+  if (!ok) return false;
+
+  vid_t N = *max_element(maxid.begin(), maxid.end()) + 1;
+
+  // count degrees (both directions)
+  vector<uint64_t> off(N+1, 0);
+  #pragma omp parallel for schedule(static,1)
+  for (int t=0; t<T; t++)
+    for (size_t e=0; e<edges[t].size(); e++)
+      __atomic_fetch_add(&off[edges[t][e]+1], 1, __ATOMIC_RELAXED);
+  for (vid_t x=0; x<N; x++)
+    off[x+1] += off[x];
+
+  // fill
+  vector<vid_t> nbr(off[N]);
+  vector<uint64_t> cursor(off.begin(), off.end()-1);
+  #pragma omp parallel for schedule(static,1)
+  for (int t=0; t<T; t++)
+    for (size_t e=0; e<edges[t].size(); e+=2) {
+      vid_t i = edges[t][e], j = edges[t][e+1];
+      nbr[__atomic_fetch_add(&cursor[i], 1, __ATOMIC_RELAXED)] = j;
+      nbr[__atomic_fetch_add(&cursor[j], 1, __ATOMIC_RELAXED)] = i;
+    }
+  vector<vector<vid_t>>().swap(edges);
+
+  // sort and remove multi-edges, row by row
+  vector<uint64_t> deg(N+1, 0);
+  #pragma omp parallel for schedule(dynamic,1024)
+  for (vid_t x=0; x<N; x++) {
+    sort(nbr.begin()+off[x], nbr.begin()+off[x+1]);
+    deg[x+1] = unique(nbr.begin()+off[x], nbr.begin()+off[x+1])
+               - (nbr.begin()+off[x]);
+  }
+  for (vid_t x=0; x<N; x++)
+    deg[x+1] += deg[x];
+
+  // compact
+  vector<vid_t> packed(deg[N]);
+  #pragma omp parallel for schedule(dynamic,1024)
+  for (vid_t x=0; x<N; x++)
+    copy(nbr.begin()+off[x], nbr.begin()+off[x]+(deg[x+1]-deg[x]),
+         packed.begin()+deg[x]);
+  vector<vid_t>().swap(nbr);
+
+  assign(deg, packed);
+  return true;
+}
+
+
+/* [header] function:  apply_delta
+ * ----------------------------------------------------------------------------
+ * Apply an edge delta file to the graph. Each line is "+ u v" (or just
+ * "u v") to insert the undirected edge, or "- u v" to delete it; other
+ * lines are skipped. The graph grows if the delta names new vertices.
+ *
+ * Args:
+ *    - filename: delta file.
+ *    - touched:  output sorted list of endpoints of the changed edges.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool Graph::apply_delta(const string& filename, vector<vid_t>& touched) {
+  ifstream infile(filename);
+  if (!infile.is_open()) return false;
+
+  vector<pair<vid_t,vid_t>> ins, del;
+  vid_t N = n;
+  string line, op;
+  while (getline(infile, line)) {
+    istringstream iss(line);
+    int64_t u, v;
+    bool insert = true;
+    if (!(iss >> op)) continue;
+    if (op == "+" || op == "-") {
+      insert = (op == "+");
+      if (!(iss >> u >> v)) continue;
+    } else {
+      istringstream first(op);
+      if (!(first >> u) || !(iss >> v)) continue;
+    }
+    if (u < 0 || v < 0 || u >= VID_MAX || v >= VID_MAX || u == v) continue;
+    vector<pair<vid_t,vid_t>>& to = insert ? ins : del;
+    to.push_back(make_pair(u, v));
+    to.push_back(make_pair(v, u));
+    N = max(N, vid_t(max(u, v)+1));
+  }
+  sort(ins.begin(), ins.end());
+  sort(del.begin(), del.end());
+
+  touched.clear();
+  for (auto&& e: ins) touched.push_back(e.first);
+  for (auto&& e: del) touched.push_back(e.first);
+  sort(touched.begin(), touched.end());
+  touched.erase(unique(touched.begin(), touched.end()), touched.end());
+
+  // rebuild each row as (old row + insertions) - deletions
+  vector<uint64_t> off(N+1, 0);
+  vector<vid_t> nbr, row, add, rem;
+  nbr.reserve((n > 0 ? offsets[n] : 0) + ins.size());
+  size_t a = 0, d = 0;
+  for (vid_t x=0; x<N; x++) {
+    add.clear();
+    rem.clear();
+    for (; a<ins.size() && ins[a].first == x; a++) add.push_back(ins[a].second);
+    for (; d<del.size() && del[d].first == x; d++) rem.push_back(del[d].second);
+    const vid_t* b = (x < n) ? adj+offsets[x] : NULL;
+    const vid_t* e = (x < n) ? adj+offsets[x+1] : NULL;
+    row.clear();
+    set_union(b, e, add.begin(), add.end(), back_inserter(row));
+    row.erase(unique(row.begin(), row.end()), row.end());
+    set_difference(row.begin(), row.end(), rem.begin(), rem.end(),
+                   back_inserter(nbr));
+    off[x+1] = nbr.size();
+  }
+
+  assign(off, nbr);
+  return true;
+}
@@ -0,0 +1,77 @@
+/* ===========================================================================
+ * Graph.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __GRAPH_H
+#define __GRAPH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Types.h"
+
+
+/* ============================================================================
+ * Graph is a read-only undirected graph in CSR form: the sorted, duplicate
+ * free neighbors of vertex v are adj[offsets[v]] ... adj[offsets[v+1]-1].
+ * The arrays are either owned by the object, mapped from a binary cache
+ * file, or borrowed from the caller; the last two are used in place
+ * without any parsing or copy.
+ * ============================================================================
+ */
+
+class Graph {
+
+public:
+  vid_t            n;        // number of vertices
+  eid_t            m;        // number of undirected edges
+  const uint64_t*  offsets;  // n+1 row offsets
+  const vid_t*     adj;      // offsets[n] neighbors
+
+  Graph();
+  ~Graph();
+  Graph(const Graph&) = delete;
+  Graph& operator =(const Graph&) = delete;
+
+  inline eid_t degree(vid_t v) const {return offsets[v+1]-offsets[v];}
+
+  void assign(std::vector<uint64_t>&, std::vector<vid_t>&);  // take ownership
+  void view(vid_t, const uint64_t*, const vid_t*);  // use arrays in place
+  void release();                                          // drop arrays
+
+  bool read_edge_list(const std::string&);    // parse a text edge list
+  bool apply_delta(const std::string&, std::vector<vid_t>&);  // edit edges
+  bool load_cache(const std::string&);        // map cache of a source file
+  bool save_cache(const std::string&) const;  // write cache of a source file
+
+private:
+  std::vector<uint64_t> own_offsets;
+  std::vector<vid_t>    own_adj;
+  void*                 region;  // mapped cache, if any
+  size_t                length;  // size of mapped cache
+};
+
+std::string cache_name(const std::string&);
+bool        source_info(const std::string&, uint64_t&, int64_t&);
+int         max_threads();
+
+#endif // __GRAPH_H
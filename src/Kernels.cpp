@@ -0,0 +1,192 @@
+/* ===========================================================================
+ * Kernels.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <cstddef>
+#include "Kernels.h"
+
+/* The vector kernels read the nodes as pairs of 64-bit words, dq and then
+ * k with its padding, so they are only built for that layout. They use
+ * separate multiply and subtract, never a fused multiply-add, so that the
+ * rounding matches the scalar code; the file is also compiled with
+ * -ffp-contract=off. */
+#if defined(__x86_64__) && !defined(FCD_COMPACT) && !defined(FCD_64BIT_IDS)
+#define SIMD_KERNELS
+#include <immintrin.h>
+static_assert(sizeof(CNode) == 16 && offsetof(CNode, dq) == 0 &&
+              offsetof(CNode, k) == 8, "unexpected CNode layout");
+#endif
+
+
+static void subtract_run_scalar(CNode* p, size_t n, double c, const double* av) {
+  for (size_t i=0; i<n; i++)
+    p[i].dq -= c*av[p[i].k];
+}
+
+static size_t select_scalar(CNode* p, size_t n, const double* av, CNode** out) {
+  size_t cnt = 0;
+  for (size_t i=0; i<n; i++)
+    if (av[p[i].k] > 0 && p[i].dq > 0)
+      out[cnt++] = p+i;
+  return cnt;
+}
+
+
+#ifdef SIMD_KERNELS
+/* AVX2: two loads bring four nodes, unpacked into their dq in lane order
+ * 0,2,1,3 and the matching words of k. */
+__attribute__((target("avx2")))
+static void subtract_run_avx2(CNode* p, size_t n, double c, const double* av) {
+  const __m256d vc = _mm256_set1_pd(c);
+  const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+  size_t i = 0;
+  for (; i+4<=n; i+=4) {
+    __m256d v0 = _mm256_loadu_pd((const double*)(p+i));
+    __m256d v1 = _mm256_loadu_pd((const double*)(p+i+2));
+    __m256d dq = _mm256_unpacklo_pd(v0, v1);
+    __m256d hi = _mm256_unpackhi_pd(v0, v1);
+    __m128i k = _mm256_castsi256_si128(
+                  _mm256_permutevar8x32_epi32(_mm256_castpd_si256(hi), low));
+    __m256d a = _mm256_i32gather_pd(av, k, 8);
+    dq = _mm256_sub_pd(dq, _mm256_mul_pd(vc, a));
+    _mm256_storeu_pd((double*)(p+i), _mm256_unpacklo_pd(dq, hi));
+    _mm256_storeu_pd((double*)(p+i+2), _mm256_unpackhi_pd(dq, hi));
+  }
+  subtract_run_scalar(p+i, n-i, c, av);
+}
+
+__attribute__((target("avx2")))
+static size_t select_avx2(CNode* p, size_t n, const double* av, CNode** out) {
+  const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+  const __m256d zero = _mm256_setzero_pd();
+  size_t cnt = 0, i = 0;
+  for (; i+4<=n; i+=4) {
+    __m256d v0 = _mm256_loadu_pd((const double*)(p+i));
+    __m256d v1 = _mm256_loadu_pd((const double*)(p+i+2));
+    __m256d dq = _mm256_unpacklo_pd(v0, v1);
+    __m256i hi = _mm256_castpd_si256(_mm256_unpackhi_pd(v0, v1));
+    __m128i k = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(hi, low));
+    __m256d a = _mm256_i32gather_pd(av, k, 8);
+    __m256d ok = _mm256_and_pd(_mm256_cmp_pd(dq, zero, _CMP_GT_OQ),
+                               _mm256_cmp_pd(a, zero, _CMP_GT_OQ));
+    unsigned m = _mm256_movemask_pd(ok);
+    m = (m & 9) | ((m & 2) << 1) | ((m & 4) >> 1);  // back to node order
+    while (m) {
+      out[cnt++] = p + i + __builtin_ctz(m);
+      m &= m-1;
+    }
+  }
+  return cnt + select_scalar(p+i, n-i, av, out+cnt);
+}
+
+
+/* AVX-512: eight nodes per step, with gathers and scatters. */
+__attribute__((target("avx512f")))
+static void subtract_run_avx512(CNode* p, size_t n, double c, const double* av) {
+  const __m512d vc = _mm512_set1_pd(c);
+  const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+  const __m256i keys = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+  size_t i = 0;
+  for (; i+8<=n; i+=8) {
+    double* base = (double*)(p+i);
+    __m512d dq = _mm512_i32gather_pd(even, base, 8);
+    __m256i k = _mm256_i32gather_epi32((const int*)base + 2, keys, 4);
+    __m512d a = _mm512_i32gather_pd(k, av, 8);
+    dq = _mm512_sub_pd(dq, _mm512_mul_pd(vc, a));
+    _mm512_i32scatter_pd(base, even, dq, 8);
+  }
+  subtract_run_scalar(p+i, n-i, c, av);
+}
+
+__attribute__((target("avx512f")))
+static size_t select_avx512(CNode* p, size_t n, const double* av, CNode** out) {
+  const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+  const __m256i keys = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+  const __m512i step = _mm512_setr_epi64(0, 16, 32, 48, 64, 80, 96, 112);
+  const __m512d zero = _mm512_setzero_pd();
+  size_t cnt = 0, i = 0;
+  for (; i+8<=n; i+=8) {
+    double* base = (double*)(p+i);
+    __m512d dq = _mm512_i32gather_pd(even, base, 8);
+    __m256i k = _mm256_i32gather_epi32((const int*)base + 2, keys, 4);
+    __m512d a = _mm512_i32gather_pd(k, av, 8);
+    __mmask8 m = _mm512_cmp_pd_mask(dq, zero, _CMP_GT_OQ)
+               & _mm512_cmp_pd_mask(a, zero, _CMP_GT_OQ);
+    __m512i ptr = _mm512_add_epi64(_mm512_set1_epi64((long long)base), step);
+    _mm512_mask_compressstoreu_epi64(out+cnt, m, ptr);
+    cnt += __builtin_popcount(m);
+  }
+  return cnt + select_scalar(p+i, n-i, av, out+cnt);
+}
+#endif
+
+
+typedef struct kernelset {
+  void   (*subtract)(CNode*, size_t, double, const double*);
+  size_t (*select)(CNode*, size_t, const double*, CNode**);
+  const char* isa;
+} KernelSet;
+
+static KernelSet pick() {
+#ifdef SIMD_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return {subtract_run_avx512, select_avx512, "avx512"};
+  if (__builtin_cpu_supports("avx2"))
+    return {subtract_run_avx2, select_avx2, "avx2"};
+#endif
+  return {subtract_run_scalar, select_scalar, "scalar"};
+}
+
+static KernelSet kernels = pick();
+
+
+void subtract_run(CNode* p, size_t n, double c, const double* av) {
+  kernels.subtract(p, n, c, av);
+}
+
+size_t select_candidates(CNode* p, size_t n, const double* av, CNode** out) {
+  return kernels.select(p, n, av, out);
+}
+
+const char* kernel_isa() {
+  return kernels.isa;
+}
+
+bool use_kernels(const std::string& isa) {
+  if (isa == "scalar") {
+    kernels = {subtract_run_scalar, select_scalar, "scalar"};
+    return true;
+  }
+#ifdef SIMD_KERNELS
+  __builtin_cpu_init();
+  if (isa == "avx512" && __builtin_cpu_supports("avx512f")) {
+    kernels = {subtract_run_avx512, select_avx512, "avx512"};
+    return true;
+  }
+  if (isa == "avx2" && __builtin_cpu_supports("avx2")) {
+    kernels = {subtract_run_avx2, select_avx2, "avx2"};
+    return true;
+  }
+#endif
+  return false;
+}
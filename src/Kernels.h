@@ -0,0 +1,54 @@
+/* ===========================================================================
+ * Kernels.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __KERNELS_H
+#define __KERNELS_H
+
+#include <cstddef>
+#include <string>
+#include "Community.h"
+
+/* ============================================================================
+ * Kernels over contiguous runs of neighborhood nodes, used by the vector
+ * backend. Each kernel has a scalar version and, for the 16-byte node of
+ * the default layout, AVX2 and AVX-512 versions; the widest one supported
+ * by the CPU is picked once at startup. All versions give the same result,
+ * bit for bit, as the scalar loops they replace.
+ * ============================================================================
+ */
+
+// p[i].dq -= c*av[p[i].k], equations (10b) and (10c) over a run of nodes
+void subtract_run(CNode* p, size_t n, double c, const double* av);
+
+// Store in out the address of the nodes with av[k] > 0 and dq > 0,
+// in node order, and return their number.
+size_t select_candidates(CNode* p, size_t n, const double* av, CNode** out);
+
+// Name of the instruction set of the kernels in use.
+const char* kernel_isa();
+
+// Use the kernels of an instruction set (scalar, avx2 or avx512) instead
+// of the one picked at startup; false if not built or not supported.
+bool use_kernels(const std::string& isa);
+
+#endif // __KERNELS_H
@@ -23,42 +23,155 @@
 #ifndef __MAXHEAP_H
 #define __MAXHEAP_H
 
-#include <queue>
+#include <vector>
+#include <cstdint>
+#include "Types.h"
 
 
 typedef struct element {
   uint64_t stamp;
-  double dq;  
-  int i;
-  int j;
-  element(int a, int b, double d, uint64_t st): i(a), j(b), dq(d), stamp(st) {}
+  dq_t  dq;
+  vid_t i;
+  vid_t j;
+  element(vid_t a, vid_t b, double d, uint64_t st): i(a), j(b), dq(d), stamp(st) {}
   ~element() {}
-} Element;  // 24B
+} Element;  // 24B (32B with 64-bit ids)
 
+// ties on dQ are broken by community id, so that the pop order depends only
+// on the heap content and not on the history of insertions.
 inline bool operator <(const struct element& e1, const struct element& e2) {
-  return e1.dq < e2.dq;
+  if (e1.dq != e2.dq) return e1.dq < e2.dq;
+  return e1.i < e2.i;
 }
 
+/* ============================================================================
+ * MaxHeap is an indexed (addressable) binary max-heap of pairs, keyed by the
+ * community id i. Each community owns at most one live entry: pushing an
+ * entry for a community already in the heap updates its key in place, so
+ * the heap never holds more than n elements and no stale entry is ever
+ * popped.
+ * ============================================================================
+ */
+
 class MaxHeap {
 
 public:
-  inline int  size() {return pq.size();}  
-  inline bool empty() {return pq.empty();}
-  inline void push(int i, int j, double dq, uint64_t st) {pq.emplace(i, j, dq, st);}
-
-  void pop(int& a, int& b, uint64_t& c) {
-    a = pq.top().i;
-    b = pq.top().j;
-    c = pq.top().stamp;
-    pq.pop();
+  inline vid_t  size() {return heap.size();}
+  inline bool empty() {return heap.empty();}
+  inline bool contains(vid_t i) {return i < pos.size() && pos[i] >= 0;}
+
+  // Logical clock of the run: every merge or rescan takes a fresh version,
+  // stored in Community::stamp and in the pushed Element::stamp.
+  inline uint64_t tick() {return ++version;}
+
+  // Insert the entry of community i, or update it if already present.
+  void push(vid_t i, vid_t j, double dq, uint64_t st) {
+    if (i >= pos.size())
+      pos.resize(i+1, -1);
+    vid_t x = pos[i];
+    if (x < 0) {
+      x = heap.size();
+      heap.emplace_back(i, j, dq, st);
+      pos[i] = x;
+      sift_up(x);
+      return;
+    }
+    double old = heap[x].dq;
+    heap[x] = Element(i, j, dq, st);
+    if (dq > old) sift_up(x);
+    else sift_down(x);
+  }
+
+  inline const Element& top() {return heap.front();}
+
+  void pop(vid_t& a, vid_t& b, uint64_t& c) {
+    a = heap.front().i;
+    b = heap.front().j;
+    c = heap.front().stamp;
+    erase(0);
+  }
+
+  // Remove the entry of community i, if any.
+  void remove(vid_t i) {
+    if (contains(i))
+      erase(pos[i]);
+  }
+
+  // Communities popped with a valid entry but not merged: they are left out
+  // of the heap until the next convergence check rebuilds their entry.
+  inline void defer(vid_t i) {deferred.push_back(i);}
+  inline std::vector<vid_t>& pending() {return deferred;}
+
+  // Current version and content of the heap, in heap order.
+  inline uint64_t now() {return version;}
+  inline const std::vector<Element>& elements() {return heap;}
+
+  // Replace the heap with saved content, already in heap order.
+  void restore(std::vector<Element>& e, uint64_t v) {
+    clear();
+    heap.swap(e);
+    for (vid_t x=0; x<heap.size(); x++) {
+      if (heap[x].i >= pos.size())
+        pos.resize(heap[x].i+1, -1);
+      pos[heap[x].i] = x;
+    }
+    version = v;
   }
 
   void clear() {
-    while (!pq.empty())
-      pq.pop();
+    for (auto&& e: heap)
+      pos[e.i] = -1;
+    heap.clear();
+    deferred.clear();
   }
 
 private:
-  std::priority_queue<Element> pq;
+  uint64_t             version = 0;  // last version handed out
+  std::vector<Element> heap;  // binary heap of entries
+  std::vector<vid_t>     pos;   // position of each community in heap, or -1
+  std::vector<vid_t>     deferred;  // communities owed an entry
+
+  void erase(vid_t x) {
+    pos[heap[x].i] = -1;
+    vid_t last = heap.size()-1;
+    if (x != last) {
+      heap[x] = heap[last];
+      pos[heap[x].i] = x;
+      heap.pop_back();
+      sift_down(x);
+      sift_up(x);
+    } else {
+      heap.pop_back();
+    }
+  }
+
+  void sift_up(vid_t x) {
+    Element e = heap[x];
+    while (x > 0) {
+      vid_t p = (x-1)/2;
+      if (!(heap[p] < e)) break;
+      heap[x] = heap[p];
+      pos[heap[x].i] = x;
+      x = p;
+    }
+    heap[x] = e;
+    pos[e.i] = x;
+  }
+
+  void sift_down(vid_t x) {
+    Element e = heap[x];
+    vid_t n = heap.size();
+    while (1) {
+      vid_t c = 2*x+1;
+      if (c >= n) break;
+      if (c+1 < n && heap[c] < heap[c+1]) c++;
+      if (!(e < heap[c])) break;
+      heap[x] = heap[c];
+      pos[heap[x].i] = x;
+      x = c;
+    }
+    heap[x] = e;
+    pos[e.i] = x;
+  }
 };  // 
-#endif // __MAXHEAP_H
\ No newline at end of file
+#endif // __MAXHEAP_H
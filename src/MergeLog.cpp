@@ -0,0 +1,118 @@
+/* ===========================================================================
+ * MergeLog.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+#include "MergeLog.h"
+using namespace std;
+
+#define MLOG_MAGIC   "FCDMRG"
+#define MLOG_VERSION 1
+
+typedef struct mlheader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t n;
+  uint64_t count;
+  double   Q0;
+} MlogHeader;
+
+
+MergeLog::MergeLog() {
+  n = 0;
+  Q0 = Q = 0;
+}
+
+
+/* [header] function:  reset
+ * ----------------------------------------------------------------------------
+ * Empty the log and reserve room for all the merges of a universe of
+ * size n, so that record never reallocates.
+ *
+ * Args:
+ *    - size: number of vertices.
+ *    - q0:   partial Q before the first merge.
+ */
+void MergeLog::reset(uint64_t size, double q0) {
+  n = size;
+  Q0 = Q = q0;
+  recs.clear();
+  recs.reserve(size > 0 ? size-1 : 0);
+}
+
+
+/* [header] function:  write
+ * ----------------------------------------------------------------------------
+ * Write the log to a binary file: header, then the records in merge order.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool MergeLog::write(const string& path) const {
+  MlogHeader hd;
+  memset(&hd, 0, sizeof(hd));
+  memcpy(hd.magic, MLOG_MAGIC, sizeof(MLOG_MAGIC));
+  hd.version = MLOG_VERSION;
+  hd.record_size = sizeof(MergeRec);
+  hd.n = n;
+  hd.count = recs.size();
+  hd.Q0 = Q0;
+
+  string tmpname = path + ".tmp";
+  ofstream out(tmpname, ios::binary);
+  if (!out.is_open()) return false;
+  out.write((const char*)&hd, sizeof(hd));
+  out.write((const char*)recs.data(), recs.size()*sizeof(MergeRec));
+  out.close();
+  if (!out) {
+    remove(tmpname.c_str());
+    return false;
+  }
+  return rename(tmpname.c_str(), path.c_str()) == 0;
+}
+
+
+/* [header] function:  read
+ * ----------------------------------------------------------------------------
+ * Read a log written by write.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool MergeLog::read(const string& path) {
+  ifstream in(path, ios::binary);
+  if (!in.is_open()) return false;
+  MlogHeader hd;
+  if (!in.read((char*)&hd, sizeof(hd))) return false;
+  if (memcmp(hd.magic, MLOG_MAGIC, sizeof(MLOG_MAGIC)) != 0 ||
+      hd.version != MLOG_VERSION || hd.record_size != sizeof(MergeRec) ||
+      hd.count > (hd.n > 0 ? hd.n-1 : 0))
+    return false;
+
+  reset(hd.n, hd.Q0);
+  recs.resize(hd.count);
+  if (!in.read((char*)recs.data(), hd.count*sizeof(MergeRec))) return false;
+  if (hd.count > 0) Q = recs.back().Q;
+  return true;
+}
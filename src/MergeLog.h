@@ -0,0 +1,71 @@
+/* ===========================================================================
+ * MergeLog.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __MERGELOG_H
+#define __MERGELOG_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Types.h"
+
+/* One merge of the agglomeration: community t was absorbed by community s
+ * with a gain dq, bringing the partial Q to Q. */
+typedef struct mergerec {
+  vid_t   s;
+  vid_t   t;
+  double  dq;
+  double  Q;
+} MergeRec;
+
+/* ============================================================================
+ * MergeLog is the history of the merges of a run, i.e. its dendrogram.
+ * Records are appended in merge order into a buffer reserved for the n-1
+ * merges a run can do at most, and the log is written as a binary file at
+ * the end of the run. Replaying a prefix of the log gives the partition at
+ * any level of the dendrogram.
+ * ============================================================================
+ */
+
+class MergeLog {
+
+public:
+  uint64_t              n;     // number of vertices
+  double                Q0;    // partial Q before the first merge
+  double                Q;     // partial Q after the last merge
+  std::vector<MergeRec> recs;
+
+  MergeLog();
+
+  void reset(uint64_t, double);  // empty log of a universe of size n
+
+  inline void record(vid_t s, vid_t t, double dq) {
+    Q += dq;
+    recs.push_back({s, t, dq, Q});
+  }
+
+  bool write(const std::string&) const;
+  bool read(const std::string&);
+};
+
+#endif // __MERGELOG_H
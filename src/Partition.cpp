@@ -0,0 +1,232 @@
+/* ===========================================================================
+ * Partition.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#include "Partition.h"
+using namespace std;
+
+#define PART_MAGIC   "FCDPART"
+#define PART_VERSION 1
+
+/* Layout of the partition file: header, offsets[communities+1],
+ * membership[n], ids[communities], members[offsets[communities]]. The
+ * arrays of ids are stored with the width of vid_t of the writer. */
+typedef struct partheader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t width;        // sizeof(vid_t)
+  uint64_t n;
+  uint64_t communities;
+  uint64_t entries;      // vertices assigned to a community
+  double   Q;
+} PartHeader;
+
+
+static size_t part_size(const PartHeader& h) {
+  return sizeof(PartHeader) + (h.communities+1)*sizeof(uint64_t)
+         + (h.n + h.communities + h.entries)*sizeof(vid_t);
+}
+
+
+Partition::Partition() {
+  n = 0;
+  communities = 0;
+  Q = 0;
+  offsets = NULL;
+  membership = NULL;
+  ids = NULL;
+  members = NULL;
+  region = NULL;
+  length = 0;
+}
+
+
+Partition::~Partition() {
+  release();
+}
+
+
+void Partition::release() {
+  if (region != NULL)
+    munmap(region, length);
+  region = NULL;
+  length = 0;
+  n = 0;
+  communities = 0;
+  offsets = NULL;
+  membership = ids = members = NULL;
+}
+
+
+vid_t Partition::find(vid_t id) const {
+  const vid_t* it = lower_bound(ids, ids + communities, id);
+  if (it == ids + communities || *it != id) return -1;
+  return it - ids;
+}
+
+
+/* [header] function:  write_partition
+ * ----------------------------------------------------------------------------
+ * Write the partition of the vertices in binary form. The file is sized
+ * up front and filled through one shared mapping, with the index built by
+ * a counting sort on the community ids, in place.
+ *
+ * Args:
+ *    - file: partition file.
+ *    - own:  community of each vertex in [0, n), or -1 if none.
+ *    - Q:    modularity of the partition.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool write_partition(const string& file, const vector<vid_t>& own, double Q) {
+  vid_t n = own.size();
+  vector<uint64_t> count(n+1, 0);
+  PartHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, PART_MAGIC, sizeof(PART_MAGIC));
+  h.version = PART_VERSION;
+  h.width = sizeof(vid_t);
+  h.n = n;
+  h.Q = Q;
+  for (vid_t v=0; v<n; v++) {
+    if (own[v] < -1 || own[v] >= n) return false;
+    if (own[v] < 0) continue;
+    if (count[own[v]]++ == 0) h.communities++;
+    h.entries++;
+  }
+
+  string tmpname = file + ".tmp";
+  int fd = open(tmpname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  size_t size = part_size(h);
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    remove(tmpname.c_str());
+    return false;
+  }
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    remove(tmpname.c_str());
+    return false;
+  }
+
+  memcpy(p, &h, sizeof(h));
+  uint64_t* off = (uint64_t*)((PartHeader*)p + 1);
+  vid_t* mem = (vid_t*)(off + h.communities+1);
+  vid_t* ids = mem + n;
+  vid_t* vs = ids + h.communities;
+  memcpy(mem, own.data(), n*sizeof(vid_t));
+
+  // count[c] becomes the next slot of community c in members
+  uint64_t c = 0, at = 0;
+  off[0] = 0;
+  for (vid_t id=0; id<n; id++) {
+    if (count[id] == 0) continue;
+    ids[c] = id;
+    uint64_t k = count[id];
+    count[id] = at;
+    at += k;
+    off[++c] = at;
+  }
+  for (vid_t v=0; v<n; v++)
+    if (own[v] >= 0)
+      vs[count[own[v]]++] = v;
+
+  bool ok = (munmap(p, size) == 0);
+  if (!ok || rename(tmpname.c_str(), file.c_str()) != 0) {
+    remove(tmpname.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+/* [header] function:  load
+ * ----------------------------------------------------------------------------
+ * Map a partition file written by write_partition.
+ *
+ * Args:
+ *    - file: partition file.
+ *
+ * Returns: true if the partition is now mapped, false otherwise.
+ */
+bool Partition::load(const string& file) {
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat buf;
+  if (fstat(fd, &buf) != 0 || buf.st_size < sizeof(PartHeader)) {
+    close(fd);
+    return false;
+  }
+  void* p = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return false;
+
+  const PartHeader* h = (const PartHeader*)p;
+  if (memcmp(h->magic, PART_MAGIC, sizeof(PART_MAGIC)) != 0 ||
+      h->version != PART_VERSION || h->width != sizeof(vid_t) ||
+      h->communities > h->n || h->entries > h->n ||
+      part_size(*h) != size_t(buf.st_size)) {
+    munmap(p, buf.st_size);
+    return false;
+  }
+  const uint64_t* off = (const uint64_t*)(h+1);
+  bool ok = (off[0] == 0 && off[h->communities] == h->entries);
+  for (uint64_t c=0; ok && c<h->communities; c++)
+    ok = off[c] < off[c+1];
+  if (!ok) {
+    munmap(p, buf.st_size);
+    return false;
+  }
+
+  release();
+  region = p;
+  length = buf.st_size;
+  n = h->n;
+  communities = h->communities;
+  Q = h->Q;
+  offsets = off;
+  membership = (const vid_t*)(off + communities+1);
+  ids = membership + n;
+  members = ids + communities;
+  return true;
+}
+
+
+bool is_partition(const string& file) {
+  char magic[8];
+  FILE* f = fopen(file.c_str(), "rb");
+  if (f == NULL) return false;
+  bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+            memcmp(magic, PART_MAGIC, sizeof(PART_MAGIC)) == 0;
+  fclose(f);
+  return ok;
+}
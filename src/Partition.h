@@ -0,0 +1,72 @@
+/* ===========================================================================
+ * Partition.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __PARTITION_H
+#define __PARTITION_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Types.h"
+
+/* ============================================================================
+ * Partition is the binary form of a full vertex to community assignment:
+ * a header, the CSR index of the communities (offsets, then the dense
+ * membership array, the community ids and their members, sorted), written
+ * through a single mapping of the file and read back by mapping it, so a
+ * partition of any size loads without parsing.
+ * Vertices left out of the partition (e.g. isolated) have community -1.
+ * ============================================================================
+ */
+
+class Partition {
+
+public:
+  vid_t            n;            // number of vertices
+  vid_t            communities;  // number of communities
+  double           Q;            // modularity reported by the run
+  const uint64_t*  offsets;      // communities+1 offsets in members
+  const vid_t*     membership;   // community of each vertex, or -1
+  const vid_t*     ids;          // id of each community, increasing
+  const vid_t*     members;      // vertices of each community, increasing
+
+  Partition();
+  ~Partition();
+  Partition(const Partition&) = delete;
+  Partition& operator =(const Partition&) = delete;
+
+  inline uint64_t size(vid_t c) const {return offsets[c+1]-offsets[c];}
+  vid_t find(vid_t id) const;        // index of a community id, or -1
+
+  bool load(const std::string&);     // map a partition file
+  void release();
+
+private:
+  void*  region;  // mapped file
+  size_t length;  // size of mapped file
+};
+
+bool write_partition(const std::string&, const std::vector<vid_t>&, double);
+bool is_partition(const std::string&);  // file starts as a partition
+
+#endif // __PARTITION_H
@@ -0,0 +1,217 @@
+/* ===========================================================================
+ * Perf.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <atomic>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include "Perf.h"
+using namespace std;
+
+typedef struct perfevent {
+  uint32_t    type;
+  uint64_t    config;
+  const char* name;
+} PerfEvent;
+
+#ifdef __linux__
+static const PerfEvent events[PERF_EVENTS] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,  "instructions"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,    "cycles"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,  "cache-misses"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch-misses"},
+  {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK,    "task-clock-ns"},
+};
+#endif
+
+static const char* region_names[R_COUNT] = {
+  "merge", "scan_max", "heap_pop", "validity"
+};
+
+// event group of a thread: fd of the leader and slot of each open event
+// in the group read, or -1
+typedef struct perfgroup {
+  bool tried = false;
+  int  leader = -1;
+  int  nr = 0;
+  int  slot[PERF_EVENTS];
+} PerfGroup;
+
+bool perf_enabled = false;
+static thread_local PerfGroup group;
+static bool available[PERF_EVENTS];  // event opened by the first thread
+static atomic<uint64_t> totals[R_COUNT][PERF_EVENTS];
+static atomic<uint64_t> calls[R_COUNT];
+static int depth = 0;  // nesting of perf_begin, as cnm runs inside cnm2
+
+
+#ifdef __linux__
+static int open_event(const PerfEvent& e, int leader) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = e.type;
+  attr.config = e.config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+#endif
+
+
+/* [] function:  open_group
+ * ----------------------------------------------------------------------------
+ * Open the event group of the calling thread, once. Other threads open
+ * only the events the first one could, so all groups read alike.
+ *
+ * Returns: true if the group has at least one event.
+ */
+static bool open_group(bool first) {
+  if (group.tried) return group.leader >= 0;
+  group.tried = true;
+#ifdef __linux__
+  for (int e=0; e<PERF_EVENTS; e++) {
+    group.slot[e] = -1;
+    if (!first && !available[e]) continue;
+    int fd = open_event(events[e], group.leader);
+    if (fd < 0) continue;
+    if (group.leader < 0) group.leader = fd;
+    group.slot[e] = group.nr++;
+  }
+  if (first)
+    for (int e=0; e<PERF_EVENTS; e++)
+      available[e] = (group.slot[e] >= 0);
+  if (group.leader >= 0) {
+    ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#endif
+  return group.leader >= 0;
+}
+
+
+/* Read the counters of the thread group, by event. */
+static bool read_group(uint64_t* out) {
+#ifdef __linux__
+  uint64_t buf[PERF_EVENTS + 1];
+  ssize_t want = (group.nr + 1)*sizeof(uint64_t);
+  if (read(group.leader, buf, want) != want) return false;
+  for (int e=0; e<PERF_EVENTS; e++)
+    out[e] = (group.slot[e] >= 0) ? buf[1 + group.slot[e]] : 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+bool PerfRegion::begin(Region r) {
+  if (!open_group(false)) return false;
+  region = r;
+  return read_group(start);
+}
+
+
+void PerfRegion::end() {
+  uint64_t stop[PERF_EVENTS];
+  if (!read_group(stop)) return;
+  for (int e=0; e<PERF_EVENTS; e++)
+    totals[region][e].fetch_add(stop[e] - start[e], memory_order_relaxed);
+  calls[region].fetch_add(1, memory_order_relaxed);
+}
+
+
+/* [header] function:  perf_enable
+ * ----------------------------------------------------------------------------
+ * Turn profiling on, opening the events on the calling thread to find
+ * which ones are available.
+ *
+ * Returns: true if at least one event can be counted, false otherwise.
+ */
+bool perf_enable() {
+  if (!open_group(true)) {
+    cerr << "perf: no counter available (perf_event_open unsupported or";
+    cerr << " not allowed by kernel.perf_event_paranoid), profiling disabled\n";
+    perf_enabled = false;
+    return false;
+  }
+#ifdef __linux__
+  for (int e=0; e<PERF_EVENTS; e++)
+    if (!available[e])
+      cerr << "perf: " << events[e].name << " not supported, left out\n";
+#endif
+  perf_enabled = true;
+  return true;
+}
+
+
+void perf_begin() {
+  if (!perf_enabled || depth++ > 0) return;
+  for (int r=0; r<R_COUNT; r++) {
+    calls[r].store(0);
+    for (int e=0; e<PERF_EVENTS; e++)
+      totals[r][e].store(0);
+  }
+}
+
+
+/* [header] function:  perf_end
+ * ----------------------------------------------------------------------------
+ * Print the totals of each region since the matching perf_begin, with the
+ * events per call. Only the outermost call prints.
+ *
+ * Args:
+ *    - label: name of the algorithm.
+ */
+void perf_end(const char* label) {
+  if (!perf_enabled || --depth > 0) return;
+#ifdef __linux__
+  cout << "perf counters of " << label << " (total, per call):\n";
+  cout << left << setw(10) << "region" << right << setw(12) << "calls";
+  for (int e=0; e<PERF_EVENTS; e++)
+    if (available[e]) cout << setw(24) << events[e].name;
+  cout << "\n";
+  for (int r=0; r<R_COUNT; r++) {
+    uint64_t n = calls[r].load();
+    cout << left << setw(10) << region_names[r] << right << setw(12) << n;
+    for (int e=0; e<PERF_EVENTS; e++) {
+      if (!available[e]) continue;
+      uint64_t v = totals[r][e].load();
+      ostringstream cell;
+      cell << v << " (" << fixed << setprecision(1) << (n > 0 ? double(v)/n : 0) << ")";
+      cout << setw(24) << cell.str();
+    }
+    cout << "\n";
+  }
+#endif
+}
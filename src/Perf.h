@@ -0,0 +1,74 @@
+/* ===========================================================================
+ * Perf.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#include <cstdint>
+
+/* ============================================================================
+ * Hardware counter profiling of the hot regions of the merge loop, through
+ * perf_event_open, enabled at runtime. Each thread opens one event group
+ * (instructions, cycles, cache misses, branch misses and task clock) and a
+ * region reads the group when it starts and ends, so regions must not
+ * nest. Events the kernel or the CPU does not support are left out; if
+ * none can be opened, profiling turns itself off with a notice.
+ * ============================================================================
+ */
+
+enum Region {
+  R_MERGE,     // Community::merge
+  R_SCAN,      // Community::scan_max
+  R_POP,       // MaxHeap::pop
+  R_VALIDITY,  // validity check of a popped pair
+  R_COUNT
+};
+
+#define PERF_EVENTS 5
+
+extern bool perf_enabled;
+
+// Counts the events from construction to destruction for a region.
+class PerfRegion {
+public:
+  explicit PerfRegion(Region r) {
+    active = perf_enabled && begin(r);
+  }
+  ~PerfRegion() {
+    if (active) end();
+  }
+  PerfRegion(const PerfRegion&) = delete;
+  PerfRegion& operator =(const PerfRegion&) = delete;
+private:
+  bool     active;
+  Region   region;
+  uint64_t start[PERF_EVENTS];
+  bool begin(Region);
+  void end();
+};
+
+bool perf_enable();                // false if no counter can be opened
+void perf_begin();                 // start of cnm or cnm2
+void perf_end(const char*);        // end of cnm or cnm2, prints the totals
+
+#endif // __PERF_H
@@ -0,0 +1,265 @@
+/* ===========================================================================
+ * Pool.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __POOL_H
+#define __POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#define POOL_SLAB (1<<20)  // bytes reserved at once by a thread, aligned
+#define POOL_HEAD 64       // slab header, holds the owner of the slab
+
+/* Counters of the node pools, summed over all threads and node sizes. */
+typedef struct poolstats {
+  uint64_t reserved;  // bytes of slabs reserved from the system
+  uint64_t live;      // nodes currently allocated
+  uint64_t recycled;  // allocations served by a free list
+} PoolStats;
+
+/* State of a pool owned by one thread at a time. Slots freed by another
+ * thread go back to the owner of their slab through the lock-free remote
+ * list. When a thread exits its pool is left to the next thread that needs
+ * one, so slabs are reused instead of piling up. The counters are written
+ * by the owner only (remote_frees by the freeing threads) and read by
+ * pool_stats() from any thread. */
+typedef struct poollocal {
+  void*    head = NULL;  // free list
+  char*    cur  = NULL;  // next untouched slot of the current slab
+  char*    end  = NULL;  // end of the current slab
+  size_t   next = 0;     // next slab to carve after the current one
+  std::vector<char*> slabs;
+  std::atomic<void*>   remote{NULL};   // slots freed by other threads
+  std::atomic<int64_t> allocs{0};
+  std::atomic<int64_t> frees{0};
+  std::atomic<int64_t> remote_frees{0};
+  std::atomic<uint64_t> recycled{0};
+  std::atomic<uint64_t> reserved{0};
+} PoolLocal;
+
+/* Increment of a counter that only the owner thread writes. */
+template <class T>
+inline void pool_bump(std::atomic<T>& c, T d = 1) {
+  c.store(c.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+}
+
+inline int64_t pool_live(const PoolLocal& l) {
+  return l.allocs.load(std::memory_order_relaxed)
+       - l.frees.load(std::memory_order_relaxed)
+       - l.remote_frees.load(std::memory_order_acquire);
+}
+
+inline std::mutex& pool_lock() {
+  static std::mutex m;
+  return m;
+}
+
+inline std::vector<PoolLocal*>& pool_locals() {
+  static std::vector<PoolLocal*> all;
+  return all;
+}
+
+/* Pools owned by the calling thread, one per node size it uses. */
+inline std::vector<PoolLocal*>& pool_mine() {
+  static thread_local std::vector<PoolLocal*> mine;
+  return mine;
+}
+
+inline PoolStats pool_stats() {
+  PoolStats st = {0, 0, 0};
+  std::lock_guard<std::mutex> g(pool_lock());
+  for (auto l: pool_locals()) {
+    st.reserved += l->reserved.load(std::memory_order_relaxed);
+    st.live += pool_live(*l);
+    st.recycled += l->recycled.load(std::memory_order_relaxed);
+  }
+  return st;
+}
+
+/* [header] function:  pool_rewind
+ * ----------------------------------------------------------------------------
+ * For each pool of the calling thread with no node allocated, drop the free
+ * list and carve the next nodes from the start of its slabs again, so that
+ * the lists built afterwards lie in allocation order instead of in the
+ * scattered order of the last frees. Slots of a pool are only ever held by
+ * its own free list, so pools of other threads are left untouched.
+ *
+ * Returns: true if all the pools of the thread were rewound.
+ */
+inline bool pool_rewind() {
+  bool all = true;
+  for (auto l: pool_mine()) {
+    if (pool_live(*l) != 0) {
+      all = false;
+      continue;
+    }
+    l->remote.store(NULL, std::memory_order_relaxed);
+    l->head = NULL;
+    l->cur = l->end = NULL;
+    l->next = 0;
+  }
+  return all;
+}
+
+/* ============================================================================
+ * SlabPool hands out fixed-size slots carved from large slabs, one slab
+ * chain and one free list per thread, so allocations never take a lock
+ * and freed slots are reused by the next allocation of the same thread.
+ * Slabs are aligned to their size and start with a pointer to their owner,
+ * so a slot freed by another thread is pushed back to the pool it came
+ * from. Slabs are kept for the whole run: the memory of released nodes is
+ * recycled, not returned to the system. A pool allocates nodes of a single
+ * size, so a thread owns one PoolLocal per node size it uses.
+ * ============================================================================
+ */
+
+template <size_t SIZE>
+class SlabPool {
+
+public:
+  static const size_t SLOT = (SIZE < sizeof(void*)) ? sizeof(void*)
+                                                    : (SIZE + 7) & ~size_t(7);
+
+  static void* get() {
+    PoolLocal& l = local();
+    pool_bump<int64_t>(l.allocs);
+    if (l.head == NULL && l.remote.load(std::memory_order_relaxed) != NULL)
+      l.head = l.remote.exchange(NULL, std::memory_order_acquire);
+    if (l.head != NULL) {
+      void* p = l.head;
+      l.head = *(void**)p;
+      pool_bump<uint64_t>(l.recycled);
+      return p;
+    }
+    if (l.cur == l.end) {
+      if (l.next == l.slabs.size()) {
+        void* s = NULL;
+        if (posix_memalign(&s, POOL_SLAB, POOL_SLAB) != 0)
+          throw std::bad_alloc();
+        *(PoolLocal**)s = &l;
+        l.slabs.push_back((char*)s);
+        pool_bump<uint64_t>(l.reserved, POOL_SLAB);
+      }
+      l.cur = l.slabs[l.next++] + POOL_HEAD;
+      l.end = l.cur + ((POOL_SLAB - POOL_HEAD) / SLOT) * SLOT;
+    }
+    void* p = l.cur;
+    l.cur += SLOT;
+    return p;
+  }
+
+  static void put(void* p) {
+    PoolLocal& l = local();
+    PoolLocal* o = *(PoolLocal**)(uintptr_t(p) & ~uintptr_t(POOL_SLAB-1));
+    if (o == &l) {
+      pool_bump<int64_t>(l.frees);
+      *(void**)p = l.head;
+      l.head = p;
+      return;
+    }
+    void* h = o->remote.load(std::memory_order_relaxed);
+    do {
+      *(void**)p = h;
+    } while (!o->remote.compare_exchange_weak(h, p,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+    o->remote_frees.fetch_add(1, std::memory_order_release);
+  }
+
+private:
+  /* Pools left behind by exited threads, waiting for a new owner. */
+  static std::vector<PoolLocal*>& orphans() {
+    static std::vector<PoolLocal*> left;
+    return left;
+  }
+
+  /* Hands the pool of an exiting thread over to the orphans. */
+  struct Owner {
+    PoolLocal* l = NULL;
+    ~Owner() {
+      if (l == NULL) return;
+      std::lock_guard<std::mutex> g(pool_lock());
+      orphans().push_back(l);
+    }
+  };
+
+  static PoolLocal& local() {
+    static thread_local Owner o;
+    if (o.l == NULL) {
+      std::lock_guard<std::mutex> g(pool_lock());
+      if (!orphans().empty()) {
+        // the largest pool, threads that allocate come first
+        auto& v = orphans();
+        size_t b = 0;
+        for (size_t i = 1; i < v.size(); i++)
+          if (v[i]->slabs.size() > v[b]->slabs.size()) b = i;
+        o.l = v[b];
+        v[b] = v.back();
+        v.pop_back();
+      } else {
+        o.l = new PoolLocal();
+        pool_locals().push_back(o.l);
+      }
+      pool_mine().push_back(o.l);
+    }
+    return *o.l;
+  }
+};
+
+
+/* Allocator of single nodes from a SlabPool, for node-based containers
+ * such as std::list. Requests of more than one object go to operator new. */
+template <class T>
+struct PoolAllocator {
+  typedef T value_type;
+
+  PoolAllocator() {}
+  template <class U> PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    if (n == 1) return (T*)SlabPool<sizeof(T)>::get();
+    return (T*)::operator new(n*sizeof(T));
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (n == 1) SlabPool<sizeof(T)>::put(p);
+    else ::operator delete(p);
+  }
+};
+
+template <class T, class U>
+inline bool operator ==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return true;
+}
+
+template <class T, class U>
+inline bool operator !=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return false;
+}
+
+#endif // __POOL_H
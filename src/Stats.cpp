@@ -0,0 +1,171 @@
+/* ===========================================================================
+ * Stats.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "Stats.h"
+using namespace std;
+
+typedef chrono::steady_clock::time_point Instant;
+
+static const char* timer_names[T_COUNT] = {
+  "parse", "build", "init_array", "init_heap", "merge", "convergence",
+  "post_processing", "output"
+};
+
+static const char* counter_names[C_COUNT] = {
+  "heap_pops", "stale_pops", "validity_rejects", "deferred", "merges",
+  "splices", "scan_max_visited", "rounds"
+};
+
+bool stats_enabled = false;
+atomic<uint64_t> stats_counters[C_COUNT];
+
+static double   seconds[T_COUNT];
+static uint64_t calls[T_COUNT];
+static int      current = -1;  // running phase, or -1
+static Instant  mark;          // last time charged to a phase
+static Instant  start;         // start of the run
+static vector<string> runs;    // JSON of the closed runs
+
+
+/* Charge the time since the last mark to the running phase. */
+static void charge(Instant now) {
+  if (current >= 0)
+    seconds[current] += chrono::duration<double>(now - mark).count();
+  mark = now;
+}
+
+
+ScopedTimer::ScopedTimer(Timer t) {
+  active = stats_enabled;
+  if (!active) return;
+  charge(chrono::steady_clock::now());
+  outer = current;
+  current = t;
+  calls[t]++;
+}
+
+
+ScopedTimer::~ScopedTimer() {
+  if (!active) return;
+  charge(chrono::steady_clock::now());
+  current = outer;
+}
+
+
+void stats_enable(bool on) {
+  stats_enabled = on;
+  stats_reset();
+}
+
+
+void stats_reset() {
+  for (int t=0; t<T_COUNT; t++) {
+    seconds[t] = 0;
+    calls[t] = 0;
+  }
+  for (int c=0; c<C_COUNT; c++)
+    stats_counters[c].store(0);
+  current = -1;
+  start = mark = chrono::steady_clock::now();
+}
+
+
+double stats_seconds(Timer t) {
+  return seconds[t];
+}
+
+
+uint64_t stats_value(Counter c) {
+  return stats_counters[c].load();
+}
+
+
+/* JSON string literal of s. */
+static string quote(const string& s) {
+  ostringstream out;
+  out << '"';
+  for (char ch: s) {
+    if (ch == '"' || ch == '\\') out << '\\' << ch;
+    else if ((unsigned char)ch < 0x20) out << ' ';
+    else out << ch;
+  }
+  out << '"';
+  return out.str();
+}
+
+
+/* [header] function:  stats_close
+ * ----------------------------------------------------------------------------
+ * Keep the timers and counters of the current run for the report, then
+ * reset them for the next one.
+ *
+ * Args:
+ *    - dataset:   trivial.
+ *    - algorithm: name of the algorithm of the run.
+ */
+void stats_close(const string& dataset, const string& algorithm) {
+  if (!stats_enabled) return;
+  double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  ostringstream out;
+  out << "    {\n";
+  out << "      \"dataset\": " << quote(dataset) << ",\n";
+  out << "      \"algorithm\": " << quote(algorithm) << ",\n";
+  out << "      \"wall_seconds\": " << wall << ",\n";
+  out << "      \"phases\": {\n";
+  for (int t=0; t<T_COUNT; t++) {
+    out << "        \"" << timer_names[t] << "\": {\"seconds\": " << seconds[t];
+    out << ", \"calls\": " << calls[t] << "}" << (t+1 < T_COUNT ? "," : "") << "\n";
+  }
+  out << "      },\n";
+  out << "      \"counters\": {\n";
+  for (int c=0; c<C_COUNT; c++) {
+    out << "        \"" << counter_names[c] << "\": " << stats_counters[c].load();
+    out << (c+1 < C_COUNT ? "," : "") << "\n";
+  }
+  out << "      }\n";
+  out << "    }";
+  runs.push_back(out.str());
+  stats_reset();
+}
+
+
+/* [header] function:  stats_report
+ * ----------------------------------------------------------------------------
+ * Write the closed runs in a JSON file.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool stats_report(const string& file) {
+  ofstream out(file);
+  if (!out.is_open()) return false;
+  out << "{\n  \"runs\": [\n";
+  for (size_t i=0; i<runs.size(); i++)
+    out << runs[i] << (i+1 < runs.size() ? "," : "") << "\n";
+  out << "  ]\n}\n";
+  out.close();
+  return bool(out);
+}
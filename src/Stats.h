@@ -0,0 +1,92 @@
+/* ===========================================================================
+ * Stats.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+/* ============================================================================
+ * Instrumentation of a run, enabled at runtime: wall-clock timers of the
+ * phases and event counters, reported in JSON. A phase timer is exclusive,
+ * so a phase nested in another (e.g. a convergence pass inside the merge
+ * loop) is not charged to the outer one. Timers are started and stopped
+ * by the main thread only; counters can be bumped from any thread. When
+ * disabled, each probe costs one load and one branch.
+ * ============================================================================
+ */
+
+enum Timer {
+  T_PARSE,        // reading the dataset or its cache
+  T_BUILD,        // building the universe
+  T_ARRAY,        // init_array
+  T_HEAP,         // init_heap
+  T_MERGE,        // merge loop of the algorithm
+  T_CONVERGENCE,  // rescans of deferred communities
+  T_POST,         // partition and statistics of the result
+  T_OUTPUT,       // result files
+  T_COUNT
+};
+
+enum Counter {
+  C_POPS,         // heap pops
+  C_STALE,        // pops whose partner was absorbed since the push
+  C_REJECTS,      // pops that failed the validity check, stale included
+  C_DEFERRED,     // valid pops left for the convergence pass (cnm2)
+  C_MERGES,       // merges
+  C_SPLICES,      // nodes moved from the absorbed neighborhood
+  C_SCANNED,      // nodes visited by scan_max
+  C_ROUNDS,       // multi-step rounds (cnm2)
+  C_COUNT
+};
+
+extern bool stats_enabled;
+extern std::atomic<uint64_t> stats_counters[C_COUNT];
+
+inline void stats_count(Counter c, uint64_t v=1) {
+  if (stats_enabled) stats_counters[c].fetch_add(v, std::memory_order_relaxed);
+}
+
+// Charges the time from construction to destruction to a phase.
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Timer t);
+  ~ScopedTimer();
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator =(const ScopedTimer&) = delete;
+private:
+  bool active;
+  int  outer;  // phase running when the timer started, or -1
+};
+
+void     stats_enable(bool);
+void     stats_reset();                          // start a new run
+double   stats_seconds(Timer);
+uint64_t stats_value(Counter);
+void     stats_close(const std::string&, const std::string&);  // keep the run
+bool     stats_report(const std::string&);       // write the kept runs
+
+#endif // __STATS_H
@@ -0,0 +1,67 @@
+/* ===========================================================================
+ * Types.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __TYPES_H
+#define __TYPES_H
+
+#include <cstdint>
+
+/* Width of vertex (and community) ids and of edge counts. Ids are 32-bit by
+ * default and 64-bit if the program is built with -DFCD_64BIT_IDS
+ * (make IDS=64); edge and adjacency counts are always 64-bit. */
+#ifdef FCD_64BIT_IDS
+typedef int64_t vid_t;
+#define VID_MAX INT64_MAX
+#else
+typedef int32_t vid_t;
+#define VID_MAX INT32_MAX
+#endif
+
+typedef int64_t eid_t;
+
+/* Type of the edge counts stored in the neighborhoods. It has the width of
+ * the ids, so that it fills the padding of a node instead of growing it;
+ * with 32-bit ids a graph may then have at most WGT_MAX edges. */
+#ifdef FCD_64BIT_IDS
+typedef int64_t wgt_t;
+#define WGT_MAX INT64_MAX
+#else
+typedef uint32_t wgt_t;
+#define WGT_MAX UINT32_MAX
+#endif
+
+/* Type of the delta Q values stored in the neighborhoods and in the heap:
+ * double, or float in the compact build (-DFCD_COMPACT, make COMPACT=1),
+ * where a node takes 12 bytes instead of 16. The compact build is not
+ * Q-equivalent: float turns near ties into ties, and a different order of
+ * the tied merges leads to a different partition (see make accuracy). */
+#ifdef FCD_COMPACT
+#ifdef FCD_64BIT_IDS
+#error "the compact layout needs 32-bit ids"
+#endif
+typedef float dq_t;
+#else
+typedef double dq_t;
+#endif
+
+#endif // __TYPES_H
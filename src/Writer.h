@@ -0,0 +1,123 @@
+/* ===========================================================================
+ * Writer.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __WRITER_H
+#define __WRITER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#define WRITER_BUFFER (1<<20)  // bytes buffered before each write
+
+/* ============================================================================
+ * TsvWriter writes text files through a large buffer, formatting integers
+ * by hand, so that exporting millions of rows costs a few large writes
+ * instead of a stream insertion per field.
+ * ============================================================================
+ */
+
+class TsvWriter {
+
+public:
+  explicit TsvWriter(const std::string& file) : buf(WRITER_BUFFER), len(0), ok(true) {
+    f = fopen(file.c_str(), "w");
+  }
+  ~TsvWriter() {close();}
+  TsvWriter(const TsvWriter&) = delete;
+  TsvWriter& operator =(const TsvWriter&) = delete;
+
+  inline bool is_open() {return f != NULL;}
+
+  TsvWriter& operator <<(const char* s) {
+    size_t n = strlen(s);
+    if (len + n > buf.size()) flush();
+    if (n > buf.size()) {
+      write(s, n);
+      return *this;
+    }
+    memcpy(buf.data() + len, s, n);
+    len += n;
+    return *this;
+  }
+
+  TsvWriter& operator <<(const std::string& s) {return *this << s.c_str();}
+
+  TsvWriter& operator <<(double v) {
+    char tmp[32];
+    snprintf(tmp, sizeof(tmp), "%g", v);
+    return *this << (const char*)tmp;
+  }
+
+  TsvWriter& operator <<(char c) {
+    if (len == buf.size()) flush();
+    buf[len++] = c;
+    return *this;
+  }
+
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value, TsvWriter&>::type
+  operator <<(T v) {
+    char tmp[24];
+    int n = 0;
+    bool neg = (v < 0);
+    uint64_t u = neg ? uint64_t(0) - uint64_t(v) : uint64_t(v);
+    do {
+      tmp[n++] = '0' + u % 10;
+      u /= 10;
+    } while (u > 0);
+    if (neg) tmp[n++] = '-';
+    if (len + n > buf.size()) flush();
+    while (n > 0) buf[len++] = tmp[--n];
+    return *this;
+  }
+
+  // Write the buffer out and close the file; false if any write failed.
+  bool close() {
+    if (f == NULL) return false;
+    flush();
+    ok = (fclose(f) == 0) && ok;
+    f = NULL;
+    return ok;
+  }
+
+private:
+  FILE*             f;
+  std::vector<char> buf;
+  size_t            len;
+  bool              ok;
+
+  void flush() {
+    write(buf.data(), len);
+    len = 0;
+  }
+
+  void write(const char* p, size_t n) {
+    if (f != NULL && n > 0 && fwrite(p, 1, n, f) != n) ok = false;
+  }
+};
+
+#endif // __WRITER_H
@@ -0,0 +1,28 @@
+# Compares the Q values printed in two files ("max Q:" lines of fcd and
+# "Q:" lines of fcd-cut), pairing them in order. Exits non-zero if the
+# files do not print the same number of values or if any pair differs by
+# more than tol.
+#
+# usage: awk -v tol=0.001 -f accuracy.awk reference.txt other.txt
+
+/max Q:|^Q:/ {
+  q[FILENAME, ++n[FILENAME]] = $NF
+}
+
+END {
+  a = ARGV[1]; b = ARGV[2]; bad = 0
+  if (n[a] == 0 || n[a] != n[b]) {
+    printf "accuracy: %d Q values in %s, %d in %s\n", n[a], a, n[b], b
+    exit 1
+  }
+  for (i = 1; i <= n[a]; i++) {
+    d = q[a, i] - q[b, i]
+    if (d < 0) d = -d
+    if (d > tol) {
+      printf "accuracy: Q %s against %s, difference %g above %g\n", q[a, i], q[b, i], d, tol
+      bad = 1
+    }
+  }
+  if (!bad) printf "accuracy: %d Q values within %g\n", n[a], tol
+  exit bad
+}
@@ -0,0 +1,404 @@
+/* ===========================================================================
+ * bench.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#include "fcd.h"
+#include "Writer.h"
+using namespace std;
+
+/* ============================================================================
+ * fcd-bench: run cnm and cnm2 on reproducible synthetic graphs, over a sweep
+ * of sizes and scopes, and write one CSV row per run.
+ *
+ *    ./fcd-bench [--gen pp,rmat,ba] [--sizes N,...] [--scopes L|auto,...]
+ *                [--degree K] [--mu MU] [--group G] [--seed S]
+ *                [--threads T] [--out FILE] [--write]
+ *
+ * Generators: planted partition (pp) with groups of G vertices and a
+ * fraction MU of the edges between groups, R-MAT (rmat) with the Graph500
+ * parameters, Barabasi-Albert (ba). All have average degree about K and
+ * depend only on the seed. Every run is done in a child process, which
+ * generates its graph, so that its peak RSS is not hidden by the previous
+ * runs nor inflated by pages of the parent. With --write the graphs
+ * are only written, as datasets named <gen>_<n>, and nothing is run.
+ * ============================================================================
+ */
+
+typedef vector<pair<vid_t,vid_t>> Edges;
+
+typedef struct benchopts {
+  vector<string> gens   = {"pp", "rmat", "ba"};
+  vector<vid_t>  sizes  = {10000, 100000};
+  vector<int>    scopes = {8, 24, 64, SCOPE_AUTO};
+  int            degree = 16;
+  double         mu     = 0.2;
+  vid_t          group  = 128;
+  uint64_t       seed   = 1;
+  int            threads = 1;
+  string         out    = "bench.csv";
+  bool           write  = false;
+} BenchOpts;
+
+
+/* [] function:  to_graph
+ * ----------------------------------------------------------------------------
+ * Build the undirected CSR graph of an edge list, dropping self-loops and
+ * duplicates.
+ */
+void to_graph(Edges& e, vid_t n, Graph& g) {
+  size_t half = e.size();
+  for (size_t i=0; i<half; i++)
+    e.emplace_back(e[i].second, e[i].first);
+  e.erase(remove_if(e.begin(), e.end(),
+                    [](const pair<vid_t,vid_t>& p) {return p.first == p.second;}),
+          e.end());
+  sort(e.begin(), e.end());
+  e.erase(unique(e.begin(), e.end()), e.end());
+
+  vector<uint64_t> off(n+1, 0);
+  vector<vid_t> adj(e.size());
+  for (size_t i=0; i<e.size(); i++) {
+    off[e[i].first+1]++;
+    adj[i] = e[i].second;
+  }
+  for (vid_t v=0; v<n; v++)
+    off[v+1] += off[v];
+  Edges().swap(e);
+  g.assign(off, adj);
+}
+
+
+/* [] function:  write_graph
+ * ----------------------------------------------------------------------------
+ * Write the edges of g, each once, as an edge list dataset.
+ */
+bool write_graph(const Graph& g, const string& file) {
+  TsvWriter out(file);
+  if (!out.is_open()) return false;
+  for (vid_t v=0; v<g.n; v++)
+    for (uint64_t e=g.offsets[v]; e<g.offsets[v+1]; e++)
+      if (v < g.adj[e])
+        out << v << '\t' << g.adj[e] << '\n';
+  return out.close();
+}
+
+
+/* [] function:  planted_partition
+ * ----------------------------------------------------------------------------
+ * Groups of o.group consecutive vertices; each edge starts at a random
+ * vertex and ends inside its group with probability 1-mu.
+ */
+void planted_partition(vid_t n, const BenchOpts& o, mt19937_64& rng, Graph& g) {
+  uniform_int_distribution<vid_t> any(0, n-1);
+  uniform_real_distribution<double> coin(0, 1);
+  vid_t group = min(o.group, n);
+  uniform_int_distribution<vid_t> inside(0, group-1);
+  Edges e;
+  e.reserve(uint64_t(n)*o.degree);
+  for (uint64_t i=0; i<uint64_t(n)*o.degree/2; i++) {
+    vid_t u = any(rng);
+    vid_t v = any(rng);
+    if (coin(rng) >= o.mu)
+      v = min(n-1, u - u%group + inside(rng));
+    e.emplace_back(u, v);
+  }
+  to_graph(e, n, g);
+}
+
+
+/* [] function:  rmat
+ * ----------------------------------------------------------------------------
+ * R-MAT with a=0.57, b=c=0.19, on the smallest power of two not below n;
+ * vertices beyond n are folded back.
+ */
+void rmat(vid_t n, const BenchOpts& o, mt19937_64& rng, Graph& g) {
+  int scale = 0;
+  while ((uint64_t(1) << scale) < uint64_t(n)) scale++;
+  uniform_real_distribution<double> coin(0, 1);
+  Edges e;
+  e.reserve(uint64_t(n)*o.degree);
+  for (uint64_t i=0; i<uint64_t(n)*o.degree/2; i++) {
+    uint64_t u = 0, v = 0;
+    for (int b=0; b<scale; b++) {
+      double r = coin(rng);
+      u <<= 1;
+      v <<= 1;
+      if (r < 0.57) continue;
+      else if (r < 0.76) v |= 1;
+      else if (r < 0.95) u |= 1;
+      else {u |= 1; v |= 1;}
+    }
+    e.emplace_back(vid_t(u % n), vid_t(v % n));
+  }
+  to_graph(e, n, g);
+}
+
+
+/* [] function:  barabasi_albert
+ * ----------------------------------------------------------------------------
+ * Preferential attachment: each new vertex links to degree/2 earlier ones,
+ * picked with probability proportional to their degree.
+ */
+void barabasi_albert(vid_t n, const BenchOpts& o, mt19937_64& rng, Graph& g) {
+  vid_t k = max(1, o.degree/2);
+  Edges e;
+  vector<vid_t> ends;  // every vertex once per incident edge
+  e.reserve(uint64_t(n)*o.degree);
+  ends.reserve(uint64_t(n)*o.degree);
+  for (vid_t u=0; u<=k && u<n; u++)
+    for (vid_t v=0; v<u; v++) {
+      e.emplace_back(u, v);
+      ends.push_back(u);
+      ends.push_back(v);
+    }
+  for (vid_t u=k+1; u<n; u++) {
+    uniform_int_distribution<size_t> pick(0, ends.size()-1);
+    for (vid_t i=0; i<k; i++) {
+      vid_t v = ends[pick(rng)];
+      e.emplace_back(u, v);
+      ends.push_back(u);
+      ends.push_back(v);
+    }
+  }
+  to_graph(e, n, g);
+}
+
+
+bool generate(const string& gen, vid_t n, const BenchOpts& o, Graph& g) {
+  // the seed of a graph depends on its generator and size only
+  mt19937_64 rng(o.seed ^ (hash<string>()(gen) + uint64_t(n)));
+  if (gen == "pp") planted_partition(n, o, rng, g);
+  else if (gen == "rmat") rmat(n, o, rng, g);
+  else if (gen == "ba") barabasi_albert(n, o, rng, g);
+  else return false;
+  return true;
+}
+
+
+/* [] function:  measure
+ * ----------------------------------------------------------------------------
+ * Run an algorithm on the graph, from the universe up, and format its CSV
+ * row. Meant to run in a child process: it rewinds the node pool and its
+ * peak RSS is that of the process.
+ *
+ * Args:
+ *    - scope: l_scope of cnm2 (SCOPE_AUTO included), or -1 for cnm.
+ */
+string measure(const Graph& g, const string& gen, int scope, int threads) {
+  vector<Community> univ;
+  vector<double>    av;
+  MaxHeap           heap;
+
+  auto t = chrono::steady_clock::now();
+  pool_rewind();  // no other universe alive in this thread
+  eid_t m = init_universe(univ, g);
+  init_array(av, univ, m);
+  double load = since(t);
+
+  t = chrono::steady_clock::now();
+  init_heap(heap, univ, av);
+  double init = since(t);
+
+  double Q = init_Q(av);
+  t = chrono::steady_clock::now();
+  if (scope >= 0)
+    tie(ignore, Q) = cnm2(Q, univ, av, heap, scope, threads);
+  else
+    tie(ignore, Q) = cnm(Q, univ, av, heap);
+  double merge = since(t);
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+
+  ostringstream row;
+  row << gen << "," << g.n << "," << g.m << ",";
+  row << (scope >= 0 ? "cnm2" : "cnm") << ",";
+  if (scope == SCOPE_AUTO) row << "auto,";
+  else if (scope > 0) row << scope << ",";
+  else row << ",";
+  row << load << "," << init << "," << merge << ",";
+  row << ru.ru_maxrss/1024.0 << ",";
+  row << stats_value(C_POPS) << ",";
+  row << stats_value(C_POPS) - stats_value(C_REJECTS) << ",";
+  row << stats_value(C_MERGES) << "," << stats_value(C_ROUNDS) << ",";
+  row << Q << "\n";
+  return row.str();
+}
+
+
+/* [] function:  isolated
+ * ----------------------------------------------------------------------------
+ * Generate the graph and run measure in a child process, and collect its
+ * row through a pipe. The parent never holds the graph, so that the peak
+ * RSS of the child does not count pages it inherited.
+ *
+ * Returns: the row, or an empty string if the child failed.
+ */
+string isolated(const string& gen, vid_t n, const BenchOpts& o, int scope) {
+  int fd[2];
+  if (pipe(fd) != 0) return "";
+  cout.flush();
+  pid_t pid = fork();
+  if (pid < 0) return "";
+  if (pid == 0) {
+    close(fd[0]);
+    cout.setstate(ios::failbit);  // quiet the progress output of the library
+    Graph g;
+    if (!generate(gen, n, o, g)) _exit(1);
+    stats_enable(true);
+    string row = measure(g, gen, scope, o.threads);
+    bool ok = write(fd[1], row.data(), row.size()) == (ssize_t)row.size();
+    close(fd[1]);
+    _exit(ok ? 0 : 1);
+  }
+  close(fd[1]);
+  string row;
+  char buf[512];
+  ssize_t r;
+  while ((r = read(fd[0], buf, sizeof(buf))) > 0)
+    row.append(buf, r);
+  close(fd[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return "";
+  return row;
+}
+
+
+template<typename T>
+bool parse_list(const string& s, vector<T>& out) {
+  out.clear();
+  istringstream in(s);
+  string item;
+  while (getline(in, item, ',')) {
+    istringstream it(item);
+    T v;
+    if (!(it >> v)) return false;
+    out.push_back(v);
+  }
+  return !out.empty();
+}
+
+
+/* MAIN */
+int main(int argc, char *argv[]) {
+  BenchOpts o;
+  for (int a=1; a<argc; a++) {
+    string opt(argv[a]);
+    bool ok = (a+1 < argc);
+    if (opt == "--write") {
+      o.write = ok = true;
+    } else if (opt == "--gen" && ok) {
+      ok = parse_list(argv[++a], o.gens);
+    } else if (opt == "--sizes" && ok) {
+      ok = parse_list(argv[++a], o.sizes);
+      for (vid_t n: o.sizes) ok = ok && n > 1;
+    } else if (opt == "--scopes" && ok) {
+      vector<string> items;
+      ok = parse_list(argv[++a], items);
+      o.scopes.clear();
+      for (auto&& it: items) {
+        int l = SCOPE_AUTO;
+        if (it != "auto") ok = ok && (istringstream(it) >> l) && l > 0;
+        o.scopes.push_back(l);
+      }
+    } else if (opt == "--degree" && ok) {
+      ok = (istringstream(argv[++a]) >> o.degree) && o.degree > 0;
+    } else if (opt == "--mu" && ok) {
+      ok = (istringstream(argv[++a]) >> o.mu) && o.mu >= 0 && o.mu <= 1;
+    } else if (opt == "--group" && ok) {
+      ok = (istringstream(argv[++a]) >> o.group) && o.group > 0;
+    } else if (opt == "--seed" && ok) {
+      ok = bool(istringstream(argv[++a]) >> o.seed);
+    } else if (opt == "--threads" && ok) {
+      ok = (istringstream(argv[++a]) >> o.threads) && o.threads > 0;
+    } else if (opt == "--out" && ok) {
+      o.out = argv[++a];
+    } else {
+      cerr << "Extra Command Line Arguments Error: unknown option " << opt << endl;
+      exit(1);
+    }
+    if (!ok) {
+      cerr << "Invalid value for " << opt << endl;
+      exit(1);
+    }
+  }
+
+  ofstream csv;
+  if (!o.write) csv.open(o.out);
+  if (!o.write && !csv.is_open()) {
+    cerr << "Error opening output file.\n";
+    exit(1);
+  }
+  csv << "generator,n,m,algorithm,scope,load_s,heap_s,merge_s,peak_rss_mb,";
+  csv << "pops,valid_pops,merges,rounds,Q\n";
+
+  for (auto&& gen: o.gens)
+    if (gen != "pp" && gen != "rmat" && gen != "ba") {
+      cerr << "Unknown generator " << gen << "\n";
+      exit(1);
+    }
+
+  for (auto&& gen: o.gens) {
+    for (vid_t n: o.sizes) {
+      if (o.write) {
+        Graph g;
+        auto t = chrono::steady_clock::now();
+        generate(gen, n, o, g);
+        cout << gen << " n=" << g.n << " m=" << g.m;
+        cout << " generated in " << since(t) << " seconds\n";
+        if (!write_graph(g, gen + "_" + to_string(n))) {
+          cerr << "Error writing graph " << gen << "_" << n << "\n";
+          exit(1);
+        }
+        continue;
+      }
+      cout << gen << " n=" << n << "\n";
+
+      vector<int> runs(1, -1);  // cnm first, then cnm2 for every scope
+      runs.insert(runs.end(), o.scopes.begin(), o.scopes.end());
+      for (int scope: runs) {
+        string row = isolated(gen, n, o, scope);
+        if (row.empty()) {
+          cerr << "Run failed: " << gen << " n=" << n << " scope " << scope << "\n";
+          continue;
+        }
+        csv << row;
+        csv.flush();
+        cout << "  " << row;
+      }
+    }
+  }
+  if (o.write) return 0;
+  csv.close();
+  cout << "results written to " << o.out << "\n";
+  return 0;
+}
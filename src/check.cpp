@@ -0,0 +1,179 @@
+/* ===========================================================================
+ * check.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstring>
+
+#include "fcd.h"
+#include "Kernels.h"
+#include "Partition.h"
+using namespace std;
+
+/* ============================================================================
+ * fcd-check: consistency checks run by make check; each mode exits
+ * non-zero on the first kind of mismatch it finds.
+ *
+ *    ./fcd-check kernels
+ *    ./fcd-check dataset tag
+ *
+ * kernels compares the AVX2 and AVX-512 kernels supported by the CPU with
+ * the scalar ones on random runs of nodes, bit for bit. dataset tag
+ * recounts the members, internal and boundary edges of every community of
+ * dataset_part_<tag>.bin on the dataset and compares them with the
+ * counters written in dataset_info_<tag>.tsv.
+ * ============================================================================
+ */
+
+#define USAGE "usage: fcd-check kernels | fcd-check dataset tag\n"
+
+
+/* [] function:  run_kernels
+ * ----------------------------------------------------------------------------
+ * Apply both kernels to a copy of a run of nodes with the kernels in use.
+ */
+void run_kernels(vector<CNode> p, const vector<double>& av, double c,
+                 vector<CNode>& res, vector<size_t>& sel) {
+  subtract_run(p.data(), p.size(), c, av.data());
+  vector<CNode*> out(p.size());
+  size_t cnt = select_candidates(p.data(), p.size(), av.data(), out.data());
+  sel.clear();
+  for (size_t i=0; i<cnt; i++)
+    sel.push_back(out[i] - p.data());
+  res = p;
+}
+
+
+/* [] function:  check_kernels
+ * ----------------------------------------------------------------------------
+ * Returns: the number of runs where a vector kernel differs from the
+ * scalar one, or -1 if no vector kernel is available.
+ */
+int check_kernels() {
+  mt19937_64 rng(1);
+  uniform_real_distribution<double> unit(-1.0, 1.0);
+  vid_t n = 4096;
+  vector<double> av(n);
+  for (auto&& a: av) a = unit(rng) * 1e-3;  // about half absorbed or empty
+
+  int tested = 0, bad = 0;
+  for (string isa: {"avx2", "avx512"}) {
+    if (!use_kernels(isa)) {
+      cout << "kernels: " << isa << " not available\n";
+      continue;
+    }
+    tested++;
+    int diff = 0;
+    for (size_t len=0; len<200; len++) {
+      vector<CNode> p;
+      for (size_t i=0; i<len; i++)
+        p.emplace_back(vid_t(rng() % n), dq_t(unit(rng) * 1e-4), 1);
+      double c = unit(rng);
+      vector<CNode> rs, rv;
+      vector<size_t> ss, sv;
+      use_kernels("scalar");
+      run_kernels(p, av, c, rs, ss);
+      use_kernels(isa);
+      run_kernels(p, av, c, rv, sv);
+      if (ss != sv || memcmp(rs.data(), rv.data(), len*sizeof(CNode)) != 0)
+        diff++;
+    }
+    cout << "kernels: " << isa << " against scalar, " << diff
+         << " of 200 runs differ\n";
+    bad += diff;
+  }
+  return tested > 0 ? bad : -1;
+}
+
+
+/* [] function:  check_counters
+ * ----------------------------------------------------------------------------
+ * Returns: the number of communities whose counters do not match the
+ * recount, or -1 if the files cannot be read.
+ */
+long check_counters(const string& filename, const string& tag) {
+  Partition p;
+  if (!p.load(filename + "_part_" + tag + ".bin")) return -1;
+  ifstream info(filename + "_info_" + tag + ".tsv");
+  if (!info.is_open()) return -1;
+  Graph g;
+  load_graph(g, filename);
+  if (g.n != p.n) return -1;
+
+  // recount, indexed by community id
+  vector<eid_t> size(g.n, 0), inner(g.n, 0), volume(g.n, 0);
+  for (vid_t v=0; v<g.n; v++) {
+    vid_t c = p.membership[v];
+    if (c < 0) continue;
+    size[c]++;
+    volume[c] += g.degree(v);
+    for (uint64_t e=g.offsets[v]; e<g.offsets[v+1]; e++)
+      if (p.membership[g.adj[e]] == c) inner[c]++;  // from both ends
+  }
+
+  string line;
+  getline(info, line);
+  long rows = 0, bad = 0;
+  while (getline(info, line)) {
+    istringstream is(line);
+    vid_t id;
+    eid_t s, in, bd;
+    if (!(is >> id >> s >> in >> bd) || id < 0 || id >= g.n) return -1;
+    rows++;
+    if (s != size[id] || in != inner[id]/2 || bd != volume[id] - inner[id]) {
+      if (bad < 10)
+        cerr << "community " << id << ": " << s << " " << in << " " << bd
+             << " against " << size[id] << " " << inner[id]/2 << " "
+             << volume[id] - inner[id] << "\n";
+      bad++;
+    }
+  }
+  if (rows != p.communities) {
+    cerr << rows << " communities in the info file, " << p.communities
+         << " in the partition\n";
+    bad++;
+  }
+  cout << "counters: " << rows << " communities of " << filename << " ("
+       << tag << "), " << bad << " mismatched\n";
+  return bad;
+}
+
+
+int main(int argc, char *argv[]) {
+  string mode = (argc > 1) ? argv[1] : "";
+  if (mode == "kernels" && argc == 2) {
+    int bad = check_kernels();
+    exit(bad > 0 ? 1 : 0);
+  }
+  if (argc != 3) {
+    cerr << USAGE;
+    exit(1);
+  }
+  long bad = check_counters(argv[1], argv[2]);
+  if (bad < 0) {
+    cerr << "Error reading the partition of " << argv[1] << " (" << argv[2] << ")\n";
+    exit(1);
+  }
+  exit(bad > 0 ? 1 : 0);
+}
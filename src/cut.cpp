@@ -0,0 +1,148 @@
+/* ===========================================================================
+ * cut.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <sstream>
+
+#include "fcd.h"
+#include "Writer.h"
+#include "Partition.h"
+using namespace std;
+
+/* ============================================================================
+ * fcd-cut: cut the dendrogram recorded in the merge log of a run, without
+ * running the algorithm again.
+ *
+ *    ./fcd-cut dataset tag [max | level K | communities C]
+ *
+ * The log is read from dataset_merges_<tag>.bin, the partition is written
+ * in dataset_part_<tag>_cut.tsv and dataset_part_<tag>_cut.bin, in the
+ * formats of dataset_part_<tag>.tsv and dataset_part_<tag>.bin.
+ * ============================================================================
+ */
+
+
+/* [] function:  find_root
+ * ----------------------------------------------------------------------------
+ * Community of a vertex in the replayed prefix, with path halving.
+ */
+vid_t find_root(vector<vid_t>& parent, vid_t v) {
+  while (parent[v] != v) {
+    parent[v] = parent[parent[v]];
+    v = parent[v];
+  }
+  return v;
+}
+
+
+/* [] function:  max_level
+ * ----------------------------------------------------------------------------
+ * Returns: the number of merges after which the partial Q is maximum (the
+ * earliest one, on ties).
+ */
+uint64_t max_level(const MergeLog& log) {
+  uint64_t best = 0;
+  double bQ = log.Q0;
+  for (uint64_t i=0; i<log.recs.size(); i++)
+    if (log.recs[i].Q > bQ) {
+      bQ = log.recs[i].Q;
+      best = i+1;
+    }
+  return best;
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    cerr << "usage: fcd-cut dataset tag [max | level K | communities C]\n";
+    exit(1);
+  }
+  string filename(argv[1]);
+  string tag(argv[2]);
+  string mode = (argc > 3) ? argv[3] : "max";
+  long long arg = -1;
+  if (mode != "max") {
+    istringstream ia((argc > 4) ? argv[4] : "");
+    if ((mode != "level" && mode != "communities") || !(ia >> arg) || arg < 0) {
+      cerr << "usage: fcd-cut dataset tag [max | level K | communities C]\n";
+      exit(1);
+    }
+  }
+
+  MergeLog log;
+  if (!log.read(filename + "_merges_" + tag + ".bin")) {
+    cerr << "Error reading merge log of " << filename << " (" << tag << ")\n";
+    exit(1);
+  }
+  Graph g;
+  load_graph(g, filename);
+  if (g.n != log.n) {
+    cerr << "Merge log does not match the dataset\n";
+    exit(1);
+  }
+
+  vid_t live = 0;
+  for (vid_t v=0; v<g.n; v++)
+    if (g.degree(v) > 0) live++;
+
+  // level of the cut, as a number of merges
+  uint64_t level;
+  if (mode == "max") level = max_level(log);
+  else if (mode == "level") level = arg;
+  else level = (arg < live) ? live - arg : 0;
+  if (level > log.recs.size()) {
+    // the log ends at max Q, the later merges were never made
+    level = log.recs.size();
+    if (mode == "communities")
+      cerr << "Warning: " << arg << " communities are not reached, the log "
+           << "ends at max Q with " << live - level << "; cutting there\n";
+    else
+      cerr << "Warning: the log has only " << level << " merges, "
+           << "it ends at max Q; cutting there\n";
+  }
+
+  vector<vid_t> parent(g.n);
+  for (vid_t v=0; v<g.n; v++) parent[v] = v;
+  for (uint64_t i=0; i<level; i++)
+    parent[log.recs[i].t] = log.recs[i].s;
+
+  vector<vid_t> own(g.n);
+  for (vid_t v=0; v<g.n; v++) own[v] = find_root(parent, v);
+  double Q = modularity(g, own);
+
+  TsvWriter out(filename + "_part_" + tag + "_cut.tsv");
+  out << "Id\tCommunity\n";
+  for (vid_t v=0; v<g.n; v++)
+    if (g.degree(v) > 0)
+      out << v << '\t' << own[v] << '\n';
+  out.close();
+  for (vid_t v=0; v<g.n; v++)
+    if (g.degree(v) == 0) own[v] = -1;
+  if (!write_partition(filename + "_part_" + tag + "_cut.bin", own, Q))
+    cerr << "Error writing binary partition\n";
+
+  cout << "level: " << level << " of " << log.recs.size() << " merges\n";
+  cout << "#communities: " << live - level << "\n";
+  cout << "partial Q: " << (level > 0 ? log.recs[level-1].Q : log.Q0) << "\n";
+  cout << "Q: " << Q << "\n";
+  exit(0);
+}
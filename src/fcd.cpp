@@ -25,7 +25,7 @@
 #include <sstream>
 #include <fstream>
 #include <cmath>
-#include <ctime>
+#include <chrono>
 
 #include "fcd.h"
 using namespace std;
@@ -43,155 +43,111 @@ bool fileExists (const string& file) {
 }
 
 
-int maximal(string filename) {
-  int i, j;
-  int maximal = -1;
-  ifstream myfile(filename);
-  if (myfile.is_open()) {
-    while (myfile >> i >> j)
-      maximal = max(maximal, max(i, j));
-    myfile.close();
-  } else {
-    cerr << "Error opening input file\n";
-    exit(1);
-  }
-  return maximal;
-}
-
-
-/* [] function:  process_dataset
+/* [header] function:  load_graph
  * ----------------------------------------------------------------------------
- * Write community vector in a text file in a proper way.
+ * Load a dataset in CSR form. If an up to date binary cache of the file
+ * exists, the graph is mapped from it, otherwise the file is parsed and the
+ * cache is written for the next runs.
+ *
  * Args:
+ *    - g:        empty graph.
  *    - filename: trivial.
- *    - univ:     community vector.
- *    - m:        number of edges.
- *
- * Returns: 0 if success, 1 otherwise.
  */
-void process_dataset (string filename, vector<Community>& univ, int m) {  
-  cout << "Start process dataset...\n";
-  ofstream outfile(filename + "_preprocess.txt");
-  if (outfile.is_open()) {
-    outfile << univ.size() << "\n";
-    outfile << m << "\n";
-    for (int x=0; x<univ.size(); x++) {
-      outfile << univ[x].id << "\n";      
-      for (auto it=univ[x].clist.begin(); it!=univ[x].clist.end(); ++it)
-        outfile << it->k << " ";
-      outfile << "\n";
-    }
-    outfile.close();
-  } else {
+void load_graph (Graph& g, string filename) {
+  if (g.load_cache(filename)) return;
+
+  cout << "Preprocessed version of file " << filename << " doesn't exists";
+  cout << " or is outdated. It will be done a new one !!\n";
+  cout << "Parsing edge list with " << max_threads() << " threads...\n";
+  if (!g.read_edge_list(filename)) {
+    cerr << "Error reading input file\n";
+    exit(1);
+  }
+  cout << "Saving dataset...\n";
+  if (!g.save_cache(filename)) {
     cerr << "Error opening output file.\n";
     exit(1);
   }
-  cout << "Finish process dataset.\n";
 }
 
 
-/* [] function:  read_data_set
+/* [] function:  compute_dq
  * ----------------------------------------------------------------------------
- * Given a formatted text file representing the graph, it builds the correspon-
- * ding representation with the community invariants.
+ * Compute the starter value of delta Q.
  *
  * Args:
- *    - filename: trivial.
- *    - univ: empty vector to be initialized.
+ *    - ki: degree of community i.
+ *    - kj: degree of community j.
+ *    - m : number of edges.
  *
- * Returns: number of edges in the graph.
+ * Returns: the computed delta Q.
  */
-int read_data_set (string filename, vector<Community>& univ) {
-
-  // name of the preprocessed file.
-  string outfilename = filename + "_preprocess.txt";
-  if (!fileExists(outfilename)) {
-    cout << "Preprocessed version of file " << filename << " doesn't exists.";
-    cout << " It will be done a new one !!\n";
-    
-    int i, j;
-    int max_id = maximal(filename); // search for maximal id
-    univ.resize(max_id+1);  // resize community universe
-    ifstream myfile(filename);
-    if (myfile.is_open()) {
-      while (myfile >> i >> j) {
-        if (i != j) {
-          univ[i].add(j, 0, false);
-          univ[j].add(i, 0, false);
-        }
-      }
-      myfile.close();
-    } else {
-      cerr << "Error opening input file\n";
-      exit(1);
-    }
-
-    // id correction
-    cout << "Assigning IDs...\n";
-    for (int id=0; id<univ.size(); id++)
-      univ[id].id = id;
-
-    // edge count
-    int edges = 0;
-    cout << "Counting number of edges...\n";
-    for (int c=0; c<univ.size(); c++)
-      edges += univ[c].clist.size();
-    edges /= 2;
+double cdq (eid_t ki, eid_t kj, eid_t m) {
+  return 2.0*(double(0.5/m) - (double(ki) * double(kj))/(4.0*m*m));
+}
 
-    cout << "Saving dataset...\n";
-    process_dataset(filename, univ, edges);
 
-    return edges;
+/* [header] function:  check_edges
+ * ----------------------------------------------------------------------------
+ * Exit if the graph has more edges than the counts of the nodes can hold
+ * (WGT_MAX, only reachable with 32-bit ids).
+ */
+void check_edges (const Graph& g) {
+  if (g.m > WGT_MAX) {
+    cerr << "Too many edges for 32-bit ids, build with IDS=64\n";
+    exit(1);
   }
+}
 
-  // read the preprocessed file
-  ifstream prefile(outfilename);
-  string line;
-  int n, m, x, y;
-  if (prefile.is_open()) {
-    // get number of nodes
-    getline(prefile, line);
-    istringstream iss(line);
-    iss >> n;
-
-    // get number of edges
-    getline(prefile, line);
-    iss = istringstream(line);
-    iss >> m;
-
-    // resize community vector
-    univ.resize(n);
-
-    while (getline(prefile, line)) {
-      iss = istringstream(line);
-      iss >> x;
-      univ[x].id = x;  // set id
-
-      getline(prefile, line);
-      iss = istringstream(line);
-      while (iss >> y)
-        univ[x].add(y,0,false);  // add neighbors
-    }
-    prefile.close();
-  }
 
-  return m;
+/* [] function:  universe_bytes
+ * ----------------------------------------------------------------------------
+ * Memory held by the community universe: the communities themselves and
+ * the nodes of their neighborhoods, list links included.
+ */
+double universe_bytes (vector<Community>& univ) {
+  double bytes = univ.capacity()*sizeof(Community);
+  for (auto&& c: univ) {
+#ifdef COMMUNITY_VECTOR
+    bytes += c.clist.capacity()*sizeof(CNode);
+#else
+    bytes += c.clist.size()*((sizeof(CNode) + 2*sizeof(void*) + 7) & ~size_t(7));
+#endif
+    bytes += c.row.capacity()*sizeof(CNode*);
+  }
+  return bytes;
 }
 
 
-/* [] function:  compute_dq
+/* [header] function:  populate_universe
  * ----------------------------------------------------------------------------
- * Compute the starter value of delta Q.
+ * Initialize the community universe/vector from a graph in memory. The
+ * node pools are not rewound here, as other universes may be alive in
+ * other threads.
  *
  * Args:
- *    - ki: degree of community i.
- *    - kj: degree of community j.
- *    - m : number of edges.
+ *    - g: graph, left untouched.
  *
- * Returns: the computed delta Q.
+ * Returns: the community vector and the number of edges.
  */
-double cdq (int ki, int kj, int m) {
-  return 2.0*(double(0.5/m) - (ki * kj)/(4.0*m*m));
+eid_t init_universe (vector<Community>& univ, const Graph& g) {
+  ScopedTimer timer(T_BUILD);
+  check_edges(g);
+  // neighbors are already sorted and unique
+  univ.resize(g.n);
+  for (vid_t x=0; x<g.n; x++) {
+    univ[x].id = univ[x].next = x;
+    univ[x].volume = g.degree(x);
+#ifdef COMMUNITY_VECTOR
+    univ[x].clist.reserve(g.degree(x));
+#endif
+    for (uint64_t e=g.offsets[x]; e<g.offsets[x+1]; e++)
+      univ[x].clist.emplace_back(g.adj[e], 0, 1);
+  }
+  for (vid_t i=0; i<univ.size(); i++)
+    for (auto it=univ[i].clist.begin(); it!=univ[i].clist.end(); ++it)
+      it->dq = cdq(univ[i].clist.size(), univ[it->k].clist.size(), g.m);
+  return g.m;
 }
 
 
@@ -204,21 +160,16 @@ double cdq (int ki, int kj, int m) {
  *
  * Returns: the community vector and the number of edges.
  */
-int init_universe (vector<Community>& univ, string filename) {
-#ifdef DEBUG
-  clock_t begin = clock();
-#endif
-  int m = read_data_set(filename, univ);  
-  for (int i=0; i<univ.size(); i++)
-    for (auto it=univ[i].clist.begin(); it!=univ[i].clist.end(); ++it)
-      it->dq = cdq(univ[i].clist.size(), univ[it->k].clist.size(), m);
-
-#ifdef DEBUG 
-  clock_t end = clock();
-  double elapsed = double(end - begin) / CLOCKS_PER_SEC;
-  cout << "Time to populate universe: " << elapsed << " seconds" << endl;
-#endif
-  return m;
+eid_t init_universe (vector<Community>& univ, string filename) {
+  Graph g;
+  {
+    ScopedTimer timer(T_PARSE);
+    load_graph(g, filename);
+  }
+  // a new universe with no other alive in this thread starts again from
+  // packed slabs
+  pool_rewind();
+  return init_universe(univ, g);
 }
 
 
@@ -232,19 +183,11 @@ int init_universe (vector<Community>& univ, string filename) {
  *
  * Returns: the double vector.
  */
-void init_array (vector<double>& av, vector<Community>& univ, int m) {
-#ifdef DEBUG
-  clock_t begin = clock();
-#endif
+void init_array (vector<double>& av, vector<Community>& univ, eid_t m) {
+  ScopedTimer timer(T_ARRAY);
   double k = (double)(0.5/m);
-  for (int i=0; i<univ.size(); i++)
+  for (vid_t i=0; i<univ.size(); i++)
     av.push_back(univ[i].clist.size() * k);
-
-#ifdef DEBUG
-  clock_t end = clock();
-  double elapsed = double(end - begin) / CLOCKS_PER_SEC;
-  cout << "Time to populate double array: " << elapsed << " seconds" << endl;
-#endif
 }
 
 
@@ -259,19 +202,10 @@ void init_array (vector<double>& av, vector<Community>& univ, int m) {
  * Returns: a priority queue (max-heap) of pairs ordered by delta Q.
  */
 void init_heap (MaxHeap& h, vector<Community>& univ, vector<double>& av) {  
-#ifdef DEBUG
-  clock_t begin = clock();
-#endif
-  for (int i=0; i<univ.size(); i++)
+  ScopedTimer timer(T_HEAP);
+  for (vid_t i=0; i<univ.size(); i++)
     if (av[i] > 0 && univ[i].scan_max(av))
       h.push(i, univ[i].cmax->k, univ[i].cmax->dq, 0);
-
-#ifdef DEBUG
-  clock_t end = clock();
-  double elapsed = double(end - begin) / CLOCKS_PER_SEC;
-  cout << "Time to populate max-heap: " << elapsed << " seconds ";
-  cout << "with " << h.size() << " elements\n";
-#endif
 }
 
 
@@ -286,127 +220,284 @@ void init_heap (MaxHeap& h, vector<Community>& univ, vector<double>& av) {
  */
 double init_Q (vector<double>& av) {
   double Q = 0.0;
-  for (int i=0; i<av.size(); i++) {
+  for (vid_t i=0; i<av.size(); i++) {
     Q += -2.0*av[i]*av[i];
   }
   return Q;
 }
 
 
-bool convergence(vector<Community>& univ, vector<double>& av, MaxHeap& h) {
-  for (auto&& c:univ) c.stamp = 0;
-  h.clear();
-  init_heap(h, univ, av);
-  return h.empty();
+/* [header] function:  modularity
+ * ----------------------------------------------------------------------------
+ * Exact modularity of a partition of the graph.
+ *
+ * Args:
+ *    - g:   graph.
+ *    - own: community of each vertex.
+ *
+ * Returns: Q of the partition.
+ */
+double modularity (const Graph& g, const vector<vid_t>& own) {
+  if (g.m == 0) return 0.0;
+  vector<double> in(g.n, 0), tot(g.n, 0);
+  for (vid_t v=0; v<g.n; v++) {
+    tot[own[v]] += g.degree(v);
+    for (uint64_t e=g.offsets[v]; e<g.offsets[v+1]; e++)
+      if (own[g.adj[e]] == own[v])
+        in[own[v]] += 1;
+  }
+  double M2 = 2.0*g.m;
+  double Q = 0.0;
+  for (vid_t c=0; c<g.n; c++)
+    Q += in[c]/M2 - (tot[c]/M2)*(tot[c]/M2);
+  return Q;
 }
 
 
-void fill(vector<Community>& univ, vector<double>& av) {
-  for (int v=0; v<univ.size(); v++)
-    if (univ[v].size() > 0)
-      univ[v].clist.emplace_back(v, 0, true);
+/* [] function:  convergence
+ * ----------------------------------------------------------------------------
+ * Check whether the run is over once the heap has been drained. A community
+ * loses its entry without merging only when it is popped as a candidate of
+ * a multi-step round and left out because its pair was already taken; such
+ * communities are deferred in the heap, and only they are rescanned here.
+ * Every other live community either holds an entry or has no pair with
+ * positive delta Q left, since its neighborhood only changes when it merges.
+ *
+ * Returns: true if no merge is left, false otherwise.
+ */
+bool convergence(vector<Community>& univ, vector<double>& av, MaxHeap& h) {
+  ScopedTimer timer(T_CONVERGENCE);
+  for (vid_t i: h.pending()) {
+    if (av[i] <= 0 || h.contains(i)) continue;
+    uint64_t st = h.tick();
+    if (univ[i].scan_max(av))
+      h.push(i, univ[i].cmax->k, univ[i].cmax->dq, st);
+    univ[i].stamp = st;
+  }
+  h.pending().clear();
+  return h.empty();
 }
 
 
-void shrink_all(vector<Community>& univ) {
-  for (auto&& c:univ)
-    for (auto it=c.clist.begin(); it!=c.clist.end();) {
-      if (!it->member)
-        it = c.clist.erase(it);
-      else ++it;
+/* [header] function:  resolve_owners
+ * ----------------------------------------------------------------------------
+ * Community of every vertex, read from av alone: an absorbed community
+ * points to the one that absorbed it, which may have been absorbed in turn,
+ * so the chains are followed (and halved) up to a live community.
+ *
+ * Args:
+ *    - av:  double vector at the end of a run.
+ *    - own: filled with the surviving community of each vertex.
+ */
+void resolve_owners(const vector<double>& av, vector<vid_t>& own) {
+  own.resize(av.size());
+  for (vid_t v=0; v<av.size(); v++)
+    own[v] = (av[v] < 0) ? owner_of(av[v]) : v;
+  for (vid_t v=0; v<own.size(); v++) {
+    vid_t r = v;
+    while (own[r] != r) {
+      own[r] = own[own[r]];
+      r = own[r];
     }
-}   
+    own[v] = r;
+  }
+}
 
 
 bool validity(Community& a, Community& b, uint64_t stamp, 
               vector<double>& av, MaxHeap& h) {
-  if (av[a.id] <= 0) return false;
+  PerfRegion perf(R_VALIDITY);
+  stats_count(C_POPS);
+  if (av[a.id] <= 0) {
+    stats_count(C_REJECTS);
+    return false;
+  }
 
   if (av[b.id] <= 0) {
+    stats_count(C_STALE);
+    stats_count(C_REJECTS);
     if (a.stamp == stamp) {
-      uint64_t st = timestamp();
-      if (a.scan_max(av))
+      uint64_t st = h.tick();
+      if (a.update_max(av))
         h.push(a.id, a.cmax->k, a.cmax->dq, st);
       a.stamp = st;
     }
     return false;
   }
 
-  if (a.stamp != stamp) return false;
+  if (a.stamp != stamp) {
+    stats_count(C_REJECTS);
+    return false;
+  }
   return true;
 }
 
 
-void merge(Community& a, Community& b, vector<double>& av, MaxHeap& h) {
-  // get timestamp
-  uint64_t st = timestamp();
-
+/* [] function:  join
+ * ----------------------------------------------------------------------------
+ * First half of a merge: the smaller neighborhood is merged into the larger
+ * one. It does not touch the heap, and the only writes to av shorten the
+ * chains of absorbed communities, pointing them at the live owner that no
+ * join of the same round can change, so joins of disjoint pairs can run
+ * concurrently.
+ *
+ * Returns: the surviving community.
+ */
+Community& join(Community& a, Community& b, vector<double>& av) {
   if (a.size() >= b.size()) {
     // remove self-edge and merge
     b.remove(a.id);
     a.merge(b, av);
-    // update av
-    av[a.id] += av[b.id];
-    av[b.id] = -(a.id);
-    // update cmax and timestamp
-    b.cmax = NULL;
-    if (a.scan_max(av))
-      h.push(a.id, a.cmax->k, a.cmax->dq, st);
-    a.stamp = st;
-  
-  } else {    
-    a.remove(b.id);
-    b.merge(a, av);
-    b.add(a.id,0,true); 
-    av[b.id] += av[a.id];
-    av[a.id] = -(b.id);
-    a.cmax = NULL;
-    if (b.scan_max(av))
-      h.push(b.id, b.cmax->k, b.cmax->dq, st);
-    b.stamp = st;
+    return a;
   }
+  a.remove(b.id);
+  b.merge(a, av);
+  return b;
+}
+
+
+/* [] function:  settle
+ * ----------------------------------------------------------------------------
+ * Second half of a merge: update av and drop the absorbed community t from
+ * the heap.
+ */
+void settle(Community& s, Community& t, vector<double>& av, MaxHeap& h) {
+  av[s.id] += av[t.id];
+  av[t.id] = absorbed(s.id);
+  t.cmax = NULL;
+  vector<CNode*>().swap(t.row);
+  h.remove(t.id);
+}
+
+
+void merge(Community& a, Community& b, vector<double>& av, MaxHeap& h,
+           MergeLog* log) {
+  // get a fresh version
+  uint64_t st = h.tick();
+  double dq = a.cmax->dq;
+
+  Community& s = join(a, b, av);
+  Community& t = (&s == &a) ? b : a;
+  settle(s, t, av, h);
+  if (log != NULL) log->record(s.id, t.id, dq);
+  stats_count(C_MERGES);
+  // update cmax and version
+  if (s.scan_max(av))
+    h.push(s.id, s.cmax->k, s.cmax->dq, st);
+  s.stamp = st;
+}
+
+
+/* [] function:  merge_round
+ * ----------------------------------------------------------------------------
+ * Merge a batch of disjoint pairs. The joins run in parallel against the
+ * av values at the start of the round, then av and the heap are updated in
+ * batch order, then the survivors are rescanned in parallel and their heap
+ * entries are pushed in batch order. No step depends on how the pairs are
+ * spread over the threads, so the result is the same for any number of
+ * threads, one included.
+ *
+ * Args:
+ *    - batch:   disjoint pairs of communities.
+ *    - threads: number of threads.
+ *    - log:     merge log, or NULL.
+ */
+void merge_round(vector<pair<vid_t,vid_t>>& batch, vector<Community>& univ,
+                 vector<double>& av, MaxHeap& h, int threads, MergeLog* log) {
+  int P = batch.size();
+  vector<Community*> surv(P);
+  vector<uint64_t> st(P);
+  vector<double> dq(P);
+  vector<char> found(P);
+
+  for (int i=0; i<P; i++)
+    dq[i] = univ[batch[i].first].cmax->dq;
+
+  #pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+  for (int i=0; i<P; i++)
+    surv[i] = &join(univ[batch[i].first], univ[batch[i].second], av);
+
+  for (int i=0; i<P; i++) {
+    vid_t t = (surv[i]->id == batch[i].first) ? batch[i].second : batch[i].first;
+    st[i] = h.tick();
+    settle(*surv[i], univ[t], av, h);
+    if (log != NULL) log->record(surv[i]->id, t, dq[i]);
+  }
+  stats_count(C_MERGES, P);
+
+  #pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+  for (int i=0; i<P; i++)
+    found[i] = surv[i]->scan_max(av);
+
+  for (int i=0; i<P; i++) {
+    Community& s = *surv[i];
+    if (found[i])
+      h.push(s.id, s.cmax->k, s.cmax->dq, st[i]);
+    s.stamp = st[i];
+  }
+}
+
+
+/* Wall-clock seconds since t. */
+double since(chrono::steady_clock::time_point t) {
+  return chrono::duration<double>(chrono::steady_clock::now() - t).count();
+}
+
+
+/* [] function:  take_checkpoint
+ * ----------------------------------------------------------------------------
+ * Record the counters of the run and save its state.
+ */
+void take_checkpoint(Checkpoint* ck, vector<Community>& univ, vector<double>& av,
+                     MaxHeap& h, double sQ, uint64_t iter, double elapsed) {
+  ck->merges = iter;
+  ck->elapsed = elapsed;
+  if (!ck->save(univ, av, h, sQ))
+    cerr << "Error writing checkpoint file " << ck->path << "\n";
 }
 
 
 pair<double, double> cnm (double Q, vector<Community>& univ, 
-                          vector<double>& av, MaxHeap& heap) {
+                          vector<double>& av, MaxHeap& heap,
+                          Checkpoint* ck, MergeLog* log) {
   
-  int x, y;
+  ScopedTimer timer(T_MERGE);
+  vid_t x, y;
   uint64_t stamp;
-  double elapsed;
-  clock_t begin, end;
 
-  int iter=0;
+  uint64_t iter = (ck != NULL) ? ck->merges : 0;
+  double base = (ck != NULL) ? ck->elapsed : 0;
   double sQ = Q;
-  clock_t begin_total = clock();
+  auto begin_total = chrono::steady_clock::now();
+  perf_begin();
+  if (ck != NULL) ck->phase = PHASE_STANDARD;
   do {    
     while (!heap.empty()) {
       // pop candidates communities
-      heap.pop(x, y, stamp);
+      {
+        PerfRegion perf(R_POP);
+        heap.pop(x, y, stamp);
+      }
       // check validity
       if (!validity(univ[x], univ[y], stamp, av, heap)) continue;
 
-#ifdef DEBUG
       iter++;
-      begin = clock();
-#endif
       // update Q
       sQ += univ[x].cmax->dq;
       // start merge sequence
-      merge(univ[x], univ[y], av, heap);
+      merge(univ[x], univ[y], av, heap, log);
 
-#ifdef DEBUG
-      if (iter%100000 == 0) {
-        cout<< "iter: "<< iter;
-        cout<< "  time elapsed: "<< double(clock()-begin_total)/CLOCKS_PER_SEC;
-        cout<< "  partial Q: "<< sQ<< "\n";         
-      }
-#endif
+      if (ck != NULL && ck->due(iter))
+        take_checkpoint(ck, univ, av, heap, sQ, iter, base + since(begin_total));
     }  // end first while loop    
   } while (!convergence(univ, av, heap));
 
-  clock_t end_total = clock();
-  double elapsed_total = double(end_total - begin_total) / CLOCKS_PER_SEC;
+  double elapsed_total = base + since(begin_total);
+  if (ck != NULL) {
+    ck->merges = iter;
+    ck->elapsed = elapsed_total;
+  }
+  perf_end("CNM-standard");
   return make_pair(elapsed_total, sQ);
 }
 
@@ -419,71 +510,108 @@ pair<double, double> cnm (double Q, vector<Community>& univ,
  *    - univ: community vector.
  *    - av  : double vector.
  *    - heap: max-heap.
- *    - m   : number of edges.
- *    - chunk_size: trivial.
+ *    - l_scope: valid pairs popped per round, or SCOPE_AUTO for rounds
+ *               that take the valid pairs within SCOPE_BAND of the best
+ *               delta Q of the round, up to SCOPE_MAX.
+ *    - threads: threads used to merge the disjoint pairs of each round,
+ *               which does not change the result.
+ *    - ck  : checkpoint of the run, or NULL.
+ *    - log : merge log, or NULL.
  *
  * Returns: tuple of <total_time, Q>
  */
 pair<double, double> cnm2 (double Q, vector<Community>& univ, 
                            vector<double>& av, MaxHeap& heap,
-                           int l_scope) {
+                           int l_scope, int threads, Checkpoint* ck,
+                           MergeLog* log) {
   
-	int x, y, l;
+  ScopedTimer timer(T_MERGE);
+  vid_t x, y;
+  int l;
   uint64_t stamp;
-  double elapsed;
-  clock_t begin, end;
+  bool adaptive = (l_scope == SCOPE_AUTO);
+  if (adaptive) l_scope = SCOPE_MAX;
 
-  int iter=0;
+  uint64_t iter = (ck != NULL) ? ck->merges : 0;
+  double base = (ck != NULL) ? ck->elapsed : 0;
+  // a run resumed inside cnm skips the multi-step rounds
+  bool standard = (ck != NULL && ck->phase == PHASE_STANDARD);
   double sQ = Q;
   vector<bool> touched(univ.size(), false);
-  vector<pair<int,int>> candidates;
+  vector<pair<vid_t,vid_t>> candidates;
+  vector<pair<vid_t,vid_t>> batch;
 
-  clock_t begin_total = clock();
-  while (!heap.empty() || candidates.size()>0) {
+  auto begin_total = chrono::steady_clock::now();
+  perf_begin();
+  if (ck != NULL) ck->phase = PHASE_MULTISTEP;
+  while (!standard && (!heap.empty() || candidates.size()>0)) {
     l=0;
+    double best = 0;  // delta Q of the first valid pair of the round
     while (!heap.empty() && l<l_scope) {
-      heap.pop(x, y, stamp);           
+      // pairs far below the best of the round would not be next in cnm,
+      // the merges of the round can offer better ones
+      if (adaptive && l > 0 && heap.top().dq < SCOPE_BAND*best) break;
+      {
+        PerfRegion perf(R_POP);
+        heap.pop(x, y, stamp);
+      }
       if (validity(univ[x], univ[y], stamp, av, heap)) {
         candidates.push_back(make_pair(x,y));
+        if (l == 0) best = univ[x].cmax->dq;
         l++;
       }
     }  // end second while loop
+    stats_count(C_ROUNDS);
 
     for (int i=0; i<candidates.size(); i++) {
       tie(x,y) = candidates[i];
-      if (touched[x] || touched[y]) continue;
+      if (touched[x] || touched[y]) {
+        if (!touched[x]) {
+          heap.defer(x);
+          stats_count(C_DEFERRED);
+        }
+        continue;
+      }
 
       touched[x] = true;
       touched[y] = true;
       
-#ifdef DEBUG
       iter++;
-      begin = clock();
-#endif  
       sQ += univ[x].cmax->dq;
-      merge(univ[x], univ[y], av, heap);
-
-#ifdef DEBUG
-      if (iter%100000 == 0) {
-        cout<< "iter: "<< iter;
-        cout<< "  time elapsed: "<< double(clock()-begin_total)/CLOCKS_PER_SEC;
-        cout<< "  partial Q: "<< sQ<< "\n";      
-      }
-#endif
+      batch.push_back(make_pair(x,y));
     }  // end first for loop
 
+    if (batch.size() > 0) {
+      merge_round(batch, univ, av, heap, threads, log);
+      batch.clear();
+    }
+
     for (int i=0; i<candidates.size(); i++) {
       tie(x,y) = candidates[i];
       touched[x] = false;
       touched[y] = false;
     }  // end second for loop
     candidates.clear();  // remove all candidates
+
+    if (ck != NULL && ck->due(iter))
+      take_checkpoint(ck, univ, av, heap, sQ, iter, base + since(begin_total));
   }  // end first while loop
 
-  while (!convergence(univ, av, heap))
-    tie(ignore, sQ) = cnm(sQ, univ, av, heap);
+  while (standard || !convergence(univ, av, heap)) {
+    standard = false;
+    if (ck != NULL) {
+      ck->merges = iter;
+      ck->elapsed = base + since(begin_total);
+    }
+    tie(ignore, sQ) = cnm(sQ, univ, av, heap, ck, log);
+    if (ck != NULL) iter = ck->merges;
+  }
 
-  clock_t end_total = clock();
-  double elapsed_total = double(end_total - begin_total) / CLOCKS_PER_SEC;
+  double elapsed_total = base + since(begin_total);
+  if (ck != NULL) {
+    ck->merges = iter;
+    ck->elapsed = elapsed_total;
+  }
+  perf_end("CNM-multistep");
   return make_pair(elapsed_total, sQ);
 }
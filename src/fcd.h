@@ -27,20 +27,39 @@
 #include <tuple>
 #include "Community.h"
 #include "MaxHeap.h"
-
-#define DEBUG
+#include "Graph.h"
+#include "Checkpoint.h"
+#include "MergeLog.h"
+#include "Stats.h"
+#include "Perf.h"
 
 // COMMONS
 bool   fileExists(const std::string&);
-int    init_universe(std::vector<Community>&, std::string);
-void   init_array(std::vector<double>&, std::vector<Community>&, int);
+void   load_graph(Graph&, std::string);
+eid_t  init_universe(std::vector<Community>&, std::string);
+eid_t  init_universe(std::vector<Community>&, const Graph&);
+void   check_edges(const Graph&);
+double universe_bytes(std::vector<Community>&);
+void   init_array(std::vector<double>&, std::vector<Community>&, eid_t);
 void   init_heap(MaxHeap&, std::vector<Community>&, std::vector<double>&);
 double init_Q(std::vector<double>&);
-void   fill(std::vector<Community>&, std::vector<double>&);
-void   shrink_all(std::vector<Community>&);
+double modularity(const Graph&, const std::vector<vid_t>&);
+void   resolve_owners(const std::vector<double>&, std::vector<vid_t>&);
+double since(std::chrono::steady_clock::time_point);
+
+// INCREMENTAL
+vid_t  init_incremental(std::vector<Community>&, std::vector<double>&, const Graph&,
+                        const std::vector<vid_t>&, const std::vector<vid_t>&);
 
 // ALGORITHMS
-std::pair<double,double> cnm(double, std::vector<Community>&, std::vector<double>&, MaxHeap&);
-std::pair<double,double> cnm2(double, std::vector<Community>&, std::vector<double>&, MaxHeap&, int);
+#define SCOPE_AUTO  0     // l_scope of cnm2 set by the delta Q of each round
+#define SCOPE_BAND  0.5   // fraction of the best delta Q of a round kept
+#define SCOPE_MAX   64    // most pairs of an adaptive round
+
+std::pair<double,double> cnm(double, std::vector<Community>&, std::vector<double>&, MaxHeap&,
+                             Checkpoint* ck=NULL, MergeLog* log=NULL);
+std::pair<double,double> cnm2(double, std::vector<Community>&, std::vector<double>&, MaxHeap&, int,
+                              int threads=1, Checkpoint* ck=NULL, MergeLog* log=NULL);
+std::pair<double,double> louvain(double, std::vector<Community>&, std::vector<double>&, int threads=1);
 
 #endif // __FCD_H
\ No newline at end of file
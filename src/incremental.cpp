@@ -0,0 +1,130 @@
+/* ===========================================================================
+ * incremental.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <algorithm>
+
+#include "fcd.h"
+using namespace std;
+
+
+/* [header] function:  init_incremental
+ * ----------------------------------------------------------------------------
+ * Build the community universe to resume the agglomeration after a change
+ * of the graph. Communities touched by the change are dissolved into
+ * singletons, every other community of the previous partition is collapsed
+ * into its representative (its lowest vertex id), with its vertices as
+ * members and aggregated delta Q towards its neighbors. The result is in
+ * the same state cnm leaves after some merges, so init_heap and cnm can run
+ * on it directly and only the dissolved vertices and the communities around
+ * them have something to merge.
+ *
+ * Args:
+ *    - univ:    empty community vector.
+ *    - av:      empty double vector.
+ *    - g:       graph after the change.
+ *    - own:     previous community of each vertex (-1 if none).
+ *    - touched: endpoints of the changed edges.
+ *
+ * Returns: number of previous communities dissolved by the change.
+ */
+vid_t init_incremental (vector<Community>& univ, vector<double>& av,
+                      const Graph& g, const vector<vid_t>& own,
+                      const vector<vid_t>& touched) {
+  check_edges(g);
+  vid_t n = g.n;
+  double M2 = 2.0*g.m;
+
+  // previous labels, dissolving the communities touched by the change
+  vector<vid_t> lab(n, -1);
+  for (vid_t v=0; v<n && v<own.size(); v++)
+    if (own[v] >= 0 && own[v] < n)
+      lab[v] = own[v];
+  vector<char> dissolved(n, 0);
+  vid_t dirty = 0;
+  for (vid_t v: touched)
+    if (lab[v] >= 0 && !dissolved[lab[v]]) {
+      dissolved[lab[v]] = 1;
+      dirty++;
+    }
+
+  vector<vid_t> rep(n, -1), node(n);
+  for (vid_t v=0; v<n; v++) {
+    if (lab[v] < 0 || dissolved[lab[v]]) {
+      node[v] = v;
+    } else {
+      if (rep[lab[v]] < 0) rep[lab[v]] = v;
+      node[v] = rep[lab[v]];
+    }
+  }
+
+  // vertices grouped by node
+  vector<vid_t> first(n+1, 0), order(n);
+  for (vid_t v=0; v<n; v++) first[node[v]+1]++;
+  for (vid_t x=0; x<n; x++) first[x+1] += first[x];
+  vector<vid_t> cursor(first.begin(), first.end()-1);
+  for (vid_t v=0; v<n; v++) order[cursor[node[v]]++] = v;
+
+  vector<double> a(n, 0);
+  for (vid_t v=0; v<n; v++)
+    a[node[v]] += g.degree(v) / M2;
+
+  univ.resize(n);
+  for (vid_t x=0; x<n; x++) {
+    univ[x].id = univ[x].next = x;
+    univ[x].volume = g.degree(x);
+  }
+  av.assign(n, 0);
+  vector<double> acc(n, 0);
+  vector<vid_t> seen;
+  for (vid_t x=0; x<n; x++) {
+    if (node[x] != x) {
+      av[x] = absorbed(node[x]);
+      continue;
+    }
+    av[x] = a[x];
+
+    eid_t in = 0;  // edges inside x, counted from both ends
+    for (vid_t y=first[x]; y<first[x+1]; y++) {
+      vid_t v = order[y];
+      if (v != x) univ[x].link(univ[v]);
+      for (uint64_t e=g.offsets[v]; e<g.offsets[v+1]; e++) {
+        vid_t d = node[g.adj[e]];
+        if (d == x) {
+          in++;
+          continue;
+        }
+        if (acc[d] == 0) seen.push_back(d);
+        acc[d] += 1;
+      }
+    }
+    univ[x].inner += in/2;
+    for (vid_t d: seen) {
+      univ[x].clist.emplace_back(d, 2.0*(acc[d]/M2 - a[x]*a[d]),
+                                 wgt_t(acc[d]));
+      acc[d] = 0;
+    }
+    seen.clear();
+    univ[x].sort();
+  }
+  return dirty;
+}
@@ -0,0 +1,105 @@
+/* ===========================================================================
+ * libfcd.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include "libfcd.h"
+#include "fcd.h"
+using namespace std;
+
+
+/* [] function:  valid_csr
+ * ----------------------------------------------------------------------------
+ * Check the shape of the CSR arrays: monotone offsets, neighbor ids in
+ * range, rows strictly increasing and free of self-loops. Symmetry is not
+ * checked.
+ */
+static bool valid_csr(vid_t n, const uint64_t* offsets, const vid_t* adj) {
+  if (n < 0 || offsets == NULL || offsets[0] != 0) return false;
+  if (offsets[n] > 0 && adj == NULL) return false;
+  for (vid_t v=0; v<n; v++) {
+    if (offsets[v+1] < offsets[v]) return false;
+    for (uint64_t e=offsets[v]; e<offsets[v+1]; e++) {
+      vid_t u = adj[e];
+      if (u < 0 || u >= n || u == v) return false;
+      if (e > offsets[v] && adj[e-1] >= u) return false;
+    }
+  }
+  return offsets[n] % 2 == 0;
+}
+
+
+/* [header] function:  fcd_detect
+ * ----------------------------------------------------------------------------
+ * Run cnm or cnm2 on a borrowed CSR graph, as run() does for a dataset, and
+ * return the membership read from av with its exact modularity. Only
+ * locals are touched: no checkpoint, no merge log, no statistics.
+ *
+ * Args:
+ *    - n, offsets, adj: graph, see libfcd.h.
+ *    - opts:            algorithm and its parameters.
+ *    - res:             result.
+ *
+ * Returns: true if success, false otherwise.
+ */
+bool fcd_detect(vid_t n, const uint64_t* offsets, const vid_t* adj,
+                const FcdOptions& opts, FcdResult& res) {
+  res = FcdResult();
+  if (opts.algorithm != FCD_CNM && opts.algorithm != FCD_CNM2) return false;
+  if (opts.scope < 0 || opts.threads < 1) return false;
+  if (!valid_csr(n, offsets, adj)) return false;
+
+  auto begin = chrono::steady_clock::now();
+  Graph g;
+  g.view(n, offsets, adj);
+  if (g.m > WGT_MAX) return false;  // see check_edges
+  vector<double> av;
+  if (g.m == 0) {
+    // no edge: every vertex is a community of its own
+    av.assign(n, 0);
+  } else {
+    vector<Community> univ;
+    MaxHeap heap;
+    auto t = chrono::steady_clock::now();
+    eid_t m = init_universe(univ, g);
+    init_array(av, univ, m);
+    res.build_seconds = since(t);
+
+    t = chrono::steady_clock::now();
+    init_heap(heap, univ, av);
+    res.heap_seconds = since(t);
+
+    double Q = init_Q(av);
+    t = chrono::steady_clock::now();
+    if (opts.algorithm == FCD_CNM) cnm(Q, univ, av, heap);
+    else cnm2(Q, univ, av, heap, opts.scope, opts.threads);
+    res.merge_seconds = since(t);
+  }
+
+  resolve_owners(av, res.membership);
+  for (vid_t v=0; v<n; v++) {
+    if (res.membership[v] == v) res.communities++;
+    else res.merges++;
+  }
+  res.Q = modularity(g, res.membership);
+  res.total_seconds = since(begin);
+  return true;
+}
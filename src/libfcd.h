@@ -0,0 +1,70 @@
+/* ===========================================================================
+ * libfcd.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#ifndef __LIBFCD_H
+#define __LIBFCD_H
+
+#include <vector>
+#include <cstdint>
+#include "Types.h"
+
+/* ============================================================================
+ * In-process API of libfcd.a: community detection on a graph already in
+ * memory, with no file I/O and no output. The graph is given in CSR form
+ * and read in place: the neighbors of vertex v are adj[offsets[v]] ...
+ * adj[offsets[v+1]-1], sorted, without duplicates or self-loops, and every
+ * edge appears in the rows of both its ends.
+ *
+ * Calls share no state, so several graphs can be processed concurrently
+ * from different threads. The library must be built with the same
+ * STORAGE, IDS and COMPACT settings as the code that includes this header.
+ * ============================================================================
+ */
+
+#define FCD_CNM  0  // standard greedy algorithm
+#define FCD_CNM2 1  // multi-step variant
+
+typedef struct fcdoptions {
+  int algorithm = FCD_CNM2;
+  int scope     = 0;  // valid pairs per round of FCD_CNM2, 0 to adapt it
+  int threads   = 1;  // threads merging the pairs of a round of FCD_CNM2
+} FcdOptions;
+
+typedef struct fcdresult {
+  std::vector<vid_t> membership;  // community of each vertex, by the id of
+                                  // one of its vertices
+  vid_t    communities = 0;       // distinct communities, isolated included
+  uint64_t merges = 0;
+  double   Q = 0;                 // modularity of the membership
+  double   build_seconds = 0;     // communities from the CSR arrays
+  double   heap_seconds = 0;      // initial scan and heap
+  double   merge_seconds = 0;     // algorithm
+  double   total_seconds = 0;
+} FcdResult;
+
+/* Detect the communities of a graph of n vertices. Returns false, leaving
+ * the result empty, if the options or the CSR arrays are not valid. */
+bool fcd_detect(vid_t n, const uint64_t* offsets, const vid_t* adj,
+                const FcdOptions& opts, FcdResult& res);
+
+#endif // __LIBFCD_H
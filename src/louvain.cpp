@@ -0,0 +1,420 @@
+/* ===========================================================================
+ * louvain.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <chrono>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "fcd.h"
+using namespace std;
+
+#define LOUVAIN_EPS    1e-7  // minimum gain of Q to keep iterating
+#define LOUVAIN_SWEEPS 64    // maximum local-moving sweeps per level
+
+/* Weighted graph of a level of the aggregation, in CSR form. Weights are
+ * edge counts of the original graph; the self-loop weight of a node is the
+ * weight of the edges inside it, counted in both directions. */
+typedef struct level {
+  vid_t            n;
+  vector<uint64_t> off;
+  vector<vid_t>    adj;
+  vector<double>   w;
+  vector<double>   self;
+  vector<double>   k;     // weighted degree, self-loop included
+} Level;
+
+
+/* Weights towards the neighbor communities of a node, in a table sized by
+ * the degree at hand rather than by the number of nodes: open addressing
+ * with linear probing, at most half full, reused from node to node by the
+ * same thread. */
+typedef struct accumulator {
+  vector<vid_t>  key;   // community of each slot, -1 if empty
+  vector<double> val;
+  vector<size_t> used;  // slots in use, in insertion order
+  int            bits = 0;
+
+  // make room for up to deg distinct communities
+  void reserve(uint64_t deg) {
+    int b = 4;
+    while ((uint64_t(1) << b) < 2*deg) b++;
+    if (b <= bits) return;
+    bits = b;
+    key.assign(size_t(1) << b, -1);
+    val.assign(size_t(1) << b, 0);
+  }
+
+  inline size_t slot(vid_t d) const {
+    size_t mask = (size_t(1) << bits) - 1;
+    size_t i = size_t((uint64_t(d) * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+    while (key[i] != d && key[i] >= 0) i = (i+1) & mask;
+    return i;
+  }
+
+  inline void add(vid_t d, double w) {
+    size_t i = slot(d);
+    if (key[i] < 0) {
+      key[i] = d;
+      used.push_back(i);
+    }
+    val[i] += w;
+  }
+
+  inline double get(vid_t d) const {
+    size_t i = slot(d);
+    return key[i] < 0 ? 0 : val[i];
+  }
+
+  void clear() {
+    for (size_t i: used) {
+      key[i] = -1;
+      val[i] = 0;
+    }
+    used.clear();
+  }
+} Accumulator;
+
+
+static inline int thread_num() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+
+static double modularity(const Level& g, const vector<vid_t>& comm, double M2) {
+  vector<double> in(g.n, 0), tot(g.n, 0);
+  for (vid_t v=0; v<g.n; v++) {
+    vid_t c = comm[v];
+    tot[c] += g.k[v];
+    in[c] += g.self[v];
+    for (uint64_t e=g.off[v]; e<g.off[v+1]; e++)
+      if (comm[g.adj[e]] == c)
+        in[c] += g.w[e];
+  }
+  double Q = 0.0;
+  for (vid_t c=0; c<g.n; c++)
+    Q += in[c]/M2 - (tot[c]/M2)*(tot[c]/M2);
+  return Q;
+}
+
+
+/* [] function:  coloring
+ * ----------------------------------------------------------------------------
+ * Greedy distance-1 coloring of a level: nodes with the same color are never
+ * adjacent, so their moves can be evaluated concurrently.
+ *
+ * Returns: the nodes grouped by color, colors delimited by first.
+ */
+static void coloring(const Level& g, vector<vid_t>& order, vector<vid_t>& first) {
+  vector<vid_t> color(g.n, -1), mark;
+  vid_t nc = 0;
+  for (vid_t v=0; v<g.n; v++) {
+    for (uint64_t e=g.off[v]; e<g.off[v+1]; e++)
+      if (color[g.adj[e]] >= 0) mark[color[g.adj[e]]] = v;
+    vid_t c = 0;
+    while (c < nc && mark[c] == v) c++;
+    if (c == nc) {
+      mark.push_back(-1);
+      nc++;
+    }
+    color[v] = c;
+  }
+
+  first.assign(nc+1, 0);
+  for (vid_t v=0; v<g.n; v++) first[color[v]+1]++;
+  for (vid_t c=0; c<nc; c++) first[c+1] += first[c];
+  vector<vid_t> cursor(first.begin(), first.end()-1);
+  order.resize(g.n);
+  for (vid_t v=0; v<g.n; v++) order[cursor[color[v]]++] = v;
+}
+
+
+/* [] function:  local_moving
+ * ----------------------------------------------------------------------------
+ * Parallel local moving: in each sweep the color classes are visited in
+ * turn, the nodes of a class pick in parallel the neighbor community with
+ * the best modularity gain, then their moves are applied. A sweep is kept
+ * only if it increases Q.
+ *
+ * Args:
+ *    - g:       graph of the level.
+ *    - comm:    output community of each node.
+ *    - M2:      total weight of the graph (2m).
+ *    - threads: number of threads.
+ *
+ * Returns: modularity of the final assignment.
+ */
+static double local_moving(const Level& g, vector<vid_t>& comm, double M2,
+                           int threads) {
+  vid_t n = g.n;
+  vector<vid_t> order, first;
+  coloring(g, order, first);
+
+  vector<vid_t> best(n), prev;
+  vector<double> tot(g.k);
+  for (vid_t v=0; v<n; v++) comm[v] = v;
+  double Q = modularity(g, comm, M2);
+
+  vector<Accumulator> acc(threads);
+
+  for (int sweep=0; sweep<LOUVAIN_SWEEPS; sweep++) {
+    prev = comm;
+    for (vid_t c=0; c+1<first.size(); c++) {
+      #pragma omp parallel for num_threads(threads) schedule(dynamic,256)
+      for (vid_t x=first[c]; x<first[c+1]; x++) {
+        vid_t v = order[x];
+        Accumulator& a = acc[thread_num()];
+        vid_t own = comm[v];
+        a.reserve(g.off[v+1] - g.off[v]);
+        for (uint64_t e=g.off[v]; e<g.off[v+1]; e++)
+          a.add(comm[g.adj[e]], g.w[e]);
+
+        double kv = g.k[v];
+        vid_t to = own;
+        double bestgain = a.get(own) - kv*(tot[own]-kv)/M2;
+        for (size_t i: a.used) {
+          vid_t d = a.key[i];
+          if (d == own) continue;
+          double gain = a.val[i] - kv*tot[d]/M2;
+          if (gain > bestgain || (gain == bestgain && d < to)) {
+            bestgain = gain;
+            to = d;
+          }
+        }
+        best[v] = to;
+        a.clear();
+      }
+
+      for (vid_t x=first[c]; x<first[c+1]; x++) {
+        vid_t v = order[x];
+        tot[comm[v]] -= g.k[v];
+        tot[best[v]] += g.k[v];
+        comm[v] = best[v];
+      }
+    }
+
+    double nQ = modularity(g, comm, M2);
+    if (nQ <= Q) {
+      comm.swap(prev);
+      break;
+    }
+    bool done = (nQ - Q < LOUVAIN_EPS);
+    Q = nQ;
+    if (done) break;
+  }
+  return Q;
+}
+
+
+/* [] function:  aggregate
+ * ----------------------------------------------------------------------------
+ * Collapse each community of a level into a single node of the next level.
+ *
+ * Args:
+ *    - g:    graph of the level.
+ *    - comm: community of each node, renumbered in place to 0..nc-1.
+ *    - out:  graph of the next level.
+ */
+static void aggregate(const Level& g, vector<vid_t>& comm, Level& out,
+                      int threads) {
+  vector<vid_t> label(g.n, -1);
+  vid_t nc = 0;
+  for (vid_t v=0; v<g.n; v++) {
+    if (label[comm[v]] < 0) label[comm[v]] = nc++;
+    comm[v] = label[comm[v]];
+  }
+
+  // nodes grouped by community
+  vector<vid_t> first(nc+1, 0), order(g.n);
+  for (vid_t v=0; v<g.n; v++) first[comm[v]+1]++;
+  for (vid_t c=0; c<nc; c++) first[c+1] += first[c];
+  vector<vid_t> cursor(first.begin(), first.end()-1);
+  for (vid_t v=0; v<g.n; v++) order[cursor[comm[v]]++] = v;
+
+  out.n = nc;
+  out.self.assign(nc, 0);
+  out.k.assign(nc, 0);
+  vector<vector<pair<vid_t,double>>> rows(nc);
+  vector<Accumulator> acc(threads);
+  vector<vector<vid_t>> seen(threads);
+
+  #pragma omp parallel for num_threads(threads) schedule(dynamic,64)
+  for (vid_t c=0; c<nc; c++) {
+    Accumulator& a = acc[thread_num()];
+    vector<vid_t>& s = seen[thread_num()];
+    uint64_t deg = 0;
+    for (vid_t x=first[c]; x<first[c+1]; x++)
+      deg += g.off[order[x]+1] - g.off[order[x]];
+    a.reserve(deg);
+    for (vid_t x=first[c]; x<first[c+1]; x++) {
+      vid_t v = order[x];
+      out.self[c] += g.self[v];
+      out.k[c] += g.k[v];
+      for (uint64_t e=g.off[v]; e<g.off[v+1]; e++) {
+        vid_t d = comm[g.adj[e]];
+        if (d == c) out.self[c] += g.w[e];
+        else a.add(d, g.w[e]);
+      }
+    }
+    for (size_t i: a.used) s.push_back(a.key[i]);
+    sort(s.begin(), s.end());
+    for (vid_t d: s)
+      rows[c].push_back(make_pair(d, a.get(d)));
+    a.clear();
+    s.clear();
+  }
+
+  out.off.assign(nc+1, 0);
+  for (vid_t c=0; c<nc; c++)
+    out.off[c+1] = out.off[c] + rows[c].size();
+  out.adj.resize(out.off[nc]);
+  out.w.resize(out.off[nc]);
+  for (vid_t c=0; c<nc; c++) {
+    for (vid_t x=0; x<rows[c].size(); x++) {
+      out.adj[out.off[c]+x] = rows[c][x].first;
+      out.w[out.off[c]+x] = rows[c][x].second;
+    }
+    vector<pair<vid_t,double>>().swap(rows[c]);
+  }
+}
+
+
+/* [] function:  write_back
+ * ----------------------------------------------------------------------------
+ * Store the partition in the universe with the same invariants left by cnm:
+ * the representative of a community (its lowest vertex id) chains the other
+ * vertices as members and lists the neighbor communities with their delta Q,
+ * av of absorbed vertices is absorbed(representative).
+ */
+static void write_back(vector<Community>& univ, vector<double>& av,
+                       const vector<vid_t>& own, const Level& g, double M2) {
+  vid_t n = univ.size();
+  vector<vid_t> rep(g.n, -1);
+  vector<double> a(g.n, 0);
+  for (vid_t v=0; v<n; v++) {
+    if (rep[own[v]] < 0) rep[own[v]] = v;
+    a[own[v]] += av[v];
+  }
+
+  for (auto&& c: univ) {
+    c.clist.clear();
+    c.cmax = NULL;
+    c.row.clear();
+    c.stamp = 0;
+    c.next = c.id;
+    c.msize = 1;
+    c.inner = 0;
+    c.volume = 0;
+  }
+  for (vid_t v=0; v<n; v++) {
+    vid_t r = rep[own[v]];
+    if (v == r) continue;
+    av[v] = absorbed(r);
+    univ[r].link(univ[v]);
+  }
+  for (vid_t c=0; c<g.n; c++) {
+    vid_t r = rep[c];
+    av[r] = a[c];
+    univ[r].inner = eid_t(g.self[c]/2);
+    univ[r].volume = eid_t(g.k[c]);
+    for (uint64_t e=g.off[c]; e<g.off[c+1]; e++) {
+      vid_t d = g.adj[e];
+      univ[r].clist.emplace_back(rep[d], 2.0*(g.w[e]/M2 - a[c]*a[d]),
+                                 wgt_t(g.w[e]));
+    }
+    univ[r].sort();
+  }
+}
+
+
+/* [header] function:  louvain
+ * ----------------------------------------------------------------------------
+ * Parallel local moving and aggregation (Blondel et al.), on the same
+ * universe and av used by cnm and cnm2. The universe must be as returned
+ * by init_universe; at the end it holds the partition in the same form
+ * left by cnm.
+ *
+ * Args:
+ *    - Q:       starting value of Q, as returned by init_Q.
+ *    - univ:    community vector.
+ *    - av:      double vector.
+ *    - threads: number of threads.
+ *
+ * Returns: tuple of <total_time, Q>
+ */
+pair<double, double> louvain (double Q, vector<Community>& univ,
+                              vector<double>& av, int threads) {
+  ScopedTimer timer(T_MERGE);
+  auto begin_total = chrono::steady_clock::now();
+  vid_t n = univ.size();
+
+  // level zero: the graph itself
+  Level g;
+  g.n = n;
+  g.off.assign(n+1, 0);
+  for (vid_t v=0; v<n; v++)
+    g.off[v+1] = g.off[v] + univ[v].clist.size();
+  g.adj.reserve(g.off[n]);
+  for (vid_t v=0; v<n; v++)
+    for (auto&& x: univ[v].clist)
+      g.adj.push_back(x.k);
+  g.w.assign(g.off[n], 1.0);
+  g.self.assign(n, 0);
+  g.k.resize(n);
+  for (vid_t v=0; v<n; v++)
+    g.k[v] = g.off[v+1] - g.off[v];
+
+  double M2 = g.off[n];
+  vector<vid_t> own(n);
+  for (vid_t v=0; v<n; v++) own[v] = v;
+
+  double gain = 0;
+  if (M2 > 0) {
+    double q0 = modularity(g, own, M2);
+    double q = q0;
+    while (1) {
+      vector<vid_t> comm(g.n);
+      double nq = local_moving(g, comm, M2, threads);
+      if (nq - q < LOUVAIN_EPS) break;
+      q = nq;
+
+      Level next;
+      aggregate(g, comm, next, threads);
+      for (vid_t v=0; v<n; v++) own[v] = comm[own[v]];
+      bool shrunk = (next.n < g.n);
+      g = move(next);
+      if (!shrunk) break;
+    }
+    gain = q - q0;
+    write_back(univ, av, own, g, M2);
+  }
+
+  double elapsed_total = chrono::duration<double>(
+                           chrono::steady_clock::now() - begin_total).count();
+  return make_pair(elapsed_total, Q + gain);
+}
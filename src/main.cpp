@@ -28,20 +28,27 @@
 #include <chrono>
 
 #include "fcd.h"
+#include "Writer.h"
+#include "Partition.h"
 using namespace std;
 
 #define OUTPUT
 #define COMP
 
-tuple<int,int,int,int> stats (vector<Community>& univ, vector<double> av) {
-  int n_of_singleton   = 0;
-	int n_of_communities = 0;
-  int max_size = 0;
-  int sc;
-  int cnt = 0;
+enum Algorithm {CNM_STANDARD, CNM_MULTISTEP, LOUVAIN};
+
+static const char* names[] = {"CNM-standard", "CNM-multistep", "Louvain"};
+static const char* tags[]  = {"std", "ms", "lv"};
+
+tuple<vid_t,vid_t,vid_t,vid_t> stats (vector<Community>& univ, vector<double> av) {
+  vid_t n_of_singleton   = 0;
+	vid_t n_of_communities = 0;
+  vid_t max_size = 0;
+  vid_t sc;
+  vid_t cnt = 0;
   double mean_size = 0;
 
-	for (int c=0; c<univ.size(); c++) {
+	for (vid_t c=0; c<univ.size(); c++) {
     sc = univ[c].members();
     if (av[c] > 0 && sc > 0) {
       cnt++;      
@@ -53,139 +60,241 @@ tuple<int,int,int,int> stats (vector<Community>& univ, vector<double> av) {
 	}
 
   return make_tuple(n_of_communities,n_of_singleton,
-                    max_size, int(mean_size/double(cnt)));
+                    max_size, vid_t(mean_size/double(cnt)));
 }
 
 
-vector<int> ownership(vector<Community>& univ) {
-  vector<int> own(univ.size(), -1);
-  for (auto&& c: univ)
-    for (auto&& m: c.clist)
-      if (m.member)
-        own[m.k] = c.id;
+/* [] function:  ownership
+ * ----------------------------------------------------------------------------
+ * Community of every vertex, in one pass over the member chains of the
+ * live communities; vertices with no edges are left out (-1).
+ */
+vector<vid_t> ownership(vector<Community>& univ, vector<double>& av) {
+  vector<vid_t> own(univ.size(), -1);
+  for (auto&& c: univ) {
+    if (av[c.id] <= 0) continue;
+    vid_t v = c.id;
+    do {
+      own[v] = c.id;
+      v = univ[v].next;
+    } while (v != c.id);
+  }
   return own;
 }
 
 
-vector<int> selection(vector<Community>& univ, int t, int m) {
-  int lowerbound = 256;
-  int upperbound = 32768;
-  int midbound = 2048;
-  vector<int> res;  
-  vector<pair<int,int>> order;
+/* [] function:  selection
+ * ----------------------------------------------------------------------------
+ * Pick the communities exported in detail: the t largest ones within the
+ * size bounds, then up to m mid-sized communities adjacent to them. Sizes
+ * are counted once, and picked communities are marked in a bitset.
+ */
+vector<vid_t> selection(vector<Community>& univ, vector<double>& av, int t, int m) {
+  size_t lowerbound = 256;
+  size_t upperbound = 32768;
+  size_t midbound = 2048;
+  vector<vid_t> res;  
+  vector<pair<size_t,vid_t>> order;
+  vector<size_t> size(univ.size(), 0);
 
   for (auto&& c: univ)
-    if (c.size() > 0)
-      order.push_back(make_pair(c.members(), c.id));
+    if (av[c.id] > 0) {
+      size[c.id] = c.members();
+      order.push_back(make_pair(size[c.id], c.id));
+    }
 
   sort(order.begin(), order.end());
   reverse(order.begin(), order.end());
 
+  vector<bool> picked(univ.size(), false);
   int cnt = 0;
-  for (int i=0; i<order.size(); i++) {
+  for (vid_t i=0; i<order.size(); i++) {
     if (cnt >= t) break;
     if (order[i].first >= lowerbound && order[i].first <= upperbound) {
       res.push_back(order[i].second);
+      picked[order[i].second] = true;
       cnt++;
     }
   }
 
-  vector<int> mid;
-  vector<int> own = ownership(univ);
+  vector<vid_t> mid;
+  vector<vid_t> own = ownership(univ, av);
 
-  for (int i: res) {
+  for (vid_t i: res) {
     cnt = 0;
     for (auto&& v: univ[i].clist) {
       if (cnt >= 64) break;
-      if (!v.member && own[v.k] >= 0) {
-        if (find(res.begin(), res.end(), own[v.k]) == res.end()) {
-          if (univ[own[v.k]].members() >= lowerbound && univ[own[v.k]].members() <= midbound) {
-            if (find(mid.begin(), mid.end(), own[v.k]) == mid.end()) {
-              mid.push_back(own[v.k]);
-              cnt++;
-            }
-          }
-        }
+      if (own[v.k] < 0) continue;
+      vid_t o = own[v.k];
+      if (!picked[o] && size[o] >= lowerbound && size[o] <= midbound) {
+        mid.push_back(o);
+        picked[o] = true;
+        cnt++;
       }
     }
   }
 
+  // there may be fewer than m mid-sized neighbors
   random_shuffle(mid.begin(), mid.end());
-  for (int i=0; i<m; i++)
-    res.push_back(mid[i]);
+  size_t take = min(size_t(max(m, 0)), mid.size());
+  res.insert(res.end(), mid.begin(), mid.begin() + take);
 
   return res;
 }
 
 
-void StructureToTSV(string filename, bool ms, 
-                    vector<Community>& univ, vector<int>& selection) {
-  vector<int> own = ownership(univ);
-  vector<bool> visited(univ.size(), false);
-  vector<Community> origin;
-  int m = init_universe(origin, filename);
-  list<CNode>::iterator it;
-  list<int> queue;
-  int front;
-
-  ofstream myfile;
-  if (ms) myfile.open (filename + "_struct_ms.tsv");
-  else myfile.open (filename + "_struct_std.tsv");
-  myfile << "Source\tTarget\n";
-
-  for (int i: selection) {
-    front = univ[i].clist.front().k;
+/* [] function:  StructureToTSV
+ * ----------------------------------------------------------------------------
+ * Write the edges of a BFS of each selected community, restricted to the
+ * vertices of selected communities, on the graph loaded for the run. Only
+ * the vertices reached by a BFS are reset before the next one.
+ *
+ * Args:
+ *    - own:       community of each vertex, as written by PartitionToTSV.
+ *    - selection: communities returned by selection.
+ *    - g:         graph of the run.
+ */
+void StructureToTSV(string filename, string tag, vector<Community>& univ,
+                    const vector<vid_t>& own, const vector<vid_t>& selection,
+                    const Graph& g) {
+  vector<bool> selected(univ.size(), false);
+  for (vid_t i: selection) selected[i] = true;
+  vector<bool> visited(g.n, false);
+  vector<vid_t> queue;  // BFS order, and the vertices to reset after it
+
+  TsvWriter out(filename + "_struct_" + tag + ".tsv");
+  out << "Source\tTarget\n";
+
+  for (vid_t i: selection) {
+    vid_t front = i;
     visited[front] = true;
     queue.push_back(front);
 
-    while (!queue.empty()) {
-      front = queue.front();
-      queue.pop_front();
-      for (it=origin[front].clist.begin(); it!=origin[front].clist.end(); ++it) {
-        if (find(selection.begin(),selection.end(),own[it->k]) != selection.end()) {
-          if (!visited[it->k]) {
-            myfile << front << "\t" << it->k << "\n";
-            visited[it->k] = true;
-            queue.push_back(it->k);
-          }
+    for (size_t h=0; h<queue.size(); h++) {
+      front = queue[h];
+      for (uint64_t e=g.offsets[front]; e<g.offsets[front+1]; e++) {
+        vid_t u = g.adj[e];
+        if (own[u] >= 0 && selected[own[u]] && !visited[u]) {
+          out << front << '\t' << u << '\n';
+          visited[u] = true;
+          queue.push_back(u);
         }
       }
-    }    
-    for (int b=0; b<visited.size(); b++)
-      visited[b] = false;
+    }
+    for (vid_t v: queue) visited[v] = false;
+    queue.clear();
   }
-  myfile.close();
+  out.close();
 }
 
 
-void SizeToTSV(string filename, bool ms, vector<Community>& univ) {
-  ofstream myfile;
-  if (ms) myfile.open (filename + "_info_ms.tsv");
-  else myfile.open (filename + "_info_std.tsv");
-  myfile << "Id\tSize\n";
+/* [] function:  SizeToTSV
+ * ----------------------------------------------------------------------------
+ * Write size, internal edges, boundary edges and conductance of every
+ * community, read from the counters kept by the merges.
+ *
+ * Args:
+ *    - m: number of edges of the graph.
+ */
+void SizeToTSV(string filename, string tag, vector<Community>& univ,
+               vector<double>& av, eid_t m) {
+  TsvWriter out(filename + "_info_" + tag + ".tsv");
+  out << "Id\tSize\tInternal\tBoundary\tConductance\n";
   for (auto&& c: univ)
-    if (c.size() > 0)
-      myfile << c.id << "\t" << c.members() << "\n";
+    if (av[c.id] > 0) {
+      eid_t vol = min(c.volume, 2*m - c.volume);
+      out << c.id << '\t' << c.members() << '\t' << c.inner << '\t'
+          << c.boundary() << '\t' << (vol > 0 ? double(c.boundary())/vol : 0.0)
+          << '\n';
+    }
+  out.close();
+}
+
+
+void CommunityToTSV(string filename, string tag, 
+                    vector<Community>& univ, const vector<vid_t>& selection) {
+  TsvWriter out(filename + "_id_" + tag + ".tsv");
+  out << "Id\tCommunity\n";
+  for (vid_t c: selection) {
+    vid_t v = c;
+    do {
+      out << v << '\t' << c << '\n';
+      v = univ[v].next;
+    } while (v != c);
+  }
+  out.close();
+}
+
+
+void PartitionToTSV(string filename, string tag, vector<vid_t>& own) {
+  TsvWriter out(filename + "_part_" + tag + ".tsv");
+  out << "Id\tCommunity\n";
+  for (vid_t v=0; v<own.size(); v++)
+    if (own[v] >= 0)
+      out << v << '\t' << own[v] << '\n';
+  out.close();
+}
+
+
+void PartitionToBIN(string filename, string tag, vector<vid_t>& own, double Q) {
+  if (!write_partition(filename + "_part_" + tag + ".bin", own, Q))
+    cerr << "Error writing binary partition\n";
+}
+
+
+vector<vid_t> LoadPartition(string filename, vid_t n) {
+  vector<vid_t> own(n, -1);
+  if (is_partition(filename)) {
+    Partition p;
+    if (!p.load(filename) || p.n != n) {
+      cerr << "Error reading partition file\n";
+      exit(1);
+    }
+    copy(p.membership, p.membership + n, own.begin());
+    return own;
+  }
+  ifstream myfile(filename);
+  if (!myfile.is_open()) {
+    cerr << "Error opening partition file\n";
+    exit(1);
+  }
+  string line;
+  getline(myfile, line);  // header
+  vid_t v, c;
+  while (myfile >> v >> c)
+    if (v >= 0 && v < n)
+      own[v] = c;
   myfile.close();
+  return own;
 }
 
 
-void CommunityToTSV(string filename, bool ms, 
-                    vector<Community>& univ, vector<int> selection) {
-  ofstream ids;
-  if (ms) ids.open (filename + "_id_ms.tsv");
-  else ids.open (filename + "_id_std.tsv");
-  ids << "Id\tCommunity\n";
-  for (int i=0; i<selection.size(); i++)
-    for (auto it=univ[selection[i]].clist.begin(); 
-        it!=univ[selection[i]].clist.end(); ++it)
-      if (it->member)
-        ids << it->k << "\t" << selection[i] << "\n";
-  ids.close();
+/* Community of every vertex, representatives included. */
+vector<vid_t> labels(vector<Community>& univ, vector<double>& av) {
+  vector<vid_t> own = ownership(univ, av);
+  for (vid_t v=0; v<own.size(); v++)
+    if (own[v] < 0) own[v] = v;
+  return own;
 }
 
 
-bool run(string filename, bool ms, int l_scope) {
+/* [] function:  run
+ * ----------------------------------------------------------------------------
+ * Run an algorithm on the dataset and write its results.
+ *
+ * Args:
+ *    - filename: dataset.
+ *    - algo:     algorithm to run.
+ *    - l_scope:  scope of the multi-step rounds, or SCOPE_AUTO.
+ *    - threads:  number of threads.
+ *    - every, seconds: checkpoint interval in merges and seconds, 0 to
+ *                disable (CNM only).
+ *    - resume:   resume from the checkpoint of a previous run, if any.
+ *
+ * Returns: true if the dataset is small enough for the comparison run.
+ */
+bool run(string filename, Algorithm algo, int l_scope, int threads,
+         uint64_t every, double seconds, bool resume) {
 /* ========================================================================= */
   vector<double>       arrv;  /* Array of elements A (see paper). If a value
                                  is less than zero, it means that the
@@ -193,58 +302,99 @@ bool run(string filename, bool ms, int l_scope) {
                                  within another. */
   vector<Community>    univ;  /* Array of Communities. */
   MaxHeap              heap;  /* Max-Heap of pairs delta Q value. */
-  int                  m;     /* Number of edges */
+  eid_t                m;     /* Number of edges */
 /* ========================================================================= */
 
 #ifdef OUTPUT
   cout << "============================================================\n";
-  if (!ms) cout << "CNM-standard\n\n";
-  else cout << "CNM-multistep\n\n";
+  cout << names[algo] << "\n\n";
 #endif
-  m = init_universe(univ, filename);
-  init_array(arrv, univ, m);
-  init_heap(heap, univ, arrv);
-  double Q = init_Q(arrv);
-
-  double total_time, sQ;
-  if (!ms) tie(total_time, sQ) = cnm(Q, univ, arrv, heap);
-  else tie(total_time, sQ) = cnm2(Q, univ, arrv, heap, l_scope);
+  Checkpoint* ck = NULL;
+  if (algo != LOUVAIN && (every > 0 || seconds > 0 || resume))
+    ck = new Checkpoint(filename + "_checkpoint_" + tags[algo] + ".bin",
+                        every, seconds);
+
+  MergeLog mlog;
+  if (ck != NULL) {
+    ck->log = &mlog;
+    ck->source = filename;
+  }
 
-#ifdef DEBUG
-  clock_t post_begin = clock();
+  // the graph stays loaded (mapped, once cached) for the export
+  Graph g;
+  double Q;
+  stats_reset();
+  {
+    ScopedTimer timer(T_PARSE);
+    load_graph(g, filename);
+  }
+  if (resume && ck != NULL && ck->load(g, univ, arrv, heap, Q)) {
+    m = ck->m;
+#ifdef OUTPUT
+    cout << "resumed after " << ck->merges << " merges\n";
 #endif
-  vector<int> sel = selection(univ, 3, 7);
-  fill(univ, arrv);
-  shrink_all(univ);
-#ifdef DEBUG 
-  clock_t post_end = clock();
-  double post_elapsed = double(post_end - post_begin) / CLOCKS_PER_SEC;
-  cout << "Time to post-processing: " << post_elapsed << " seconds" << endl;
+  } else {
+    // a new universe with no other alive in this thread starts again from
+    // packed slabs
+    pool_rewind();
+    m = init_universe(univ, g);
+#ifdef OUTPUT
+    double bytes = universe_bytes(univ);
+    cout << "Memory of universe: " << bytes/(1<<20) << " MB, ";
+    cout << (m > 0 ? bytes/m : 0) << " bytes per edge" << endl;
 #endif
+    init_array(arrv, univ, m);
+    if (algo != LOUVAIN) init_heap(heap, univ, arrv);
+    Q = init_Q(arrv);
+    if (ck != NULL) ck->m = m;
+    mlog.reset(univ.size(), Q);
+  }
 
-  int cms, sngl, maxs, mns;
-  tie(cms, sngl, maxs, mns) = stats(univ, arrv);
+  double total_time, sQ;
+  if (algo == CNM_STANDARD)
+    tie(total_time, sQ) = cnm(Q, univ, arrv, heap, ck, &mlog);
+  else if (algo == CNM_MULTISTEP)
+    tie(total_time, sQ) = cnm2(Q, univ, arrv, heap, l_scope, threads, ck, &mlog);
+  else tie(total_time, sQ) = louvain(Q, univ, arrv, threads);
+  if (ck != NULL) {
+    ck->discard();
+    delete ck;
+  }
 
-  ofstream myfile;
-  myfile.open ("summary_" + filename, ios::app);
-  if (!ms) myfile << "CNM-standard  ";
-  else myfile << "CNM-multistep  l_scope: " << l_scope << " ";
-  myfile << "maxQ " << sQ << " total_time " << total_time << " ";
-  myfile << "#minors " << sngl << " #communities " << cms << " ";
-  myfile << "max size: " << maxs << " mean size: " << mns << "\n";
-  myfile.close();
+  vector<vid_t> sel, own;
+  vid_t cms, sngl, maxs, mns;
+  {
+    ScopedTimer timer(T_POST);
+    sel = selection(univ, arrv, 3, 7);
+    own = ownership(univ, arrv);
+    tie(cms, sngl, maxs, mns) = stats(univ, arrv);
+  }
 
-#ifdef DEBUG
-  clock_t begin = clock();
-#endif
-  SizeToTSV(filename, ms, univ);
-  CommunityToTSV(filename, ms, univ, sel);
-  StructureToTSV(filename, ms, univ, sel);
-#ifdef DEBUG 
-  clock_t end = clock();
-  double elapsed = double(end - begin) / CLOCKS_PER_SEC;
-  cout << "Time to generate tsv files: " << elapsed << " seconds" << endl;
-#endif
+  {
+    ScopedTimer timer(T_OUTPUT);
+    ofstream myfile;
+    myfile.open ("summary_" + filename, ios::app);
+    myfile << names[algo] << "  ";
+    if (algo == CNM_MULTISTEP) {
+      myfile << "l_scope: ";
+      if (l_scope == SCOPE_AUTO) myfile << "auto ";
+      else myfile << l_scope << " ";
+    }
+    if (algo != CNM_STANDARD) myfile << "threads: " << threads << " ";
+    myfile << "maxQ " << sQ << " total_time " << total_time << " ";
+    myfile << "#minors " << sngl << " #communities " << cms << " ";
+    myfile << "max size: " << maxs << " mean size: " << mns << "\n";
+    myfile.close();
+
+    PartitionToTSV(filename, tags[algo], own);
+    PartitionToBIN(filename, tags[algo], own, sQ);
+    if (algo != LOUVAIN && !mlog.write(filename + "_merges_" + tags[algo] + ".bin"))
+      cerr << "Error writing merge log\n";
+    SizeToTSV(filename, tags[algo], univ, arrv, m);
+    CommunityToTSV(filename, tags[algo], univ, sel);
+    StructureToTSV(filename, tags[algo], univ, own, sel, g);
+  }
+  stats_close(filename, names[algo]);
 
 #ifdef OUTPUT
   cout << "# vertices: " << univ.size() << "\n";
@@ -253,12 +403,95 @@ bool run(string filename, bool ms, int l_scope) {
   cout << "max Q: " << sQ << "\n";
   cout << "#minors: " << sngl << "\t#communities: " << cms << "\n";
   cout << "max size: " << maxs << " mean size: " << mns << "\n";
+#ifndef COMMUNITY_VECTOR
+  PoolStats ps = pool_stats();
+  cout << "node pool: " << ps.reserved/(1<<20) << " MB reserved, ";
+  cout << ps.live << " live nodes, " << ps.recycled << " recycled\n";
+#endif
   cout << "============================================================\n\n";
 #endif  
   return (univ.size()<600000 && m<3000000);
 }
 
 
+/* [] function:  run_incremental
+ * ----------------------------------------------------------------------------
+ * Update a previous partition of the dataset after applying an edge delta,
+ * re-running the agglomeration only around the changed edges.
+ *
+ * Args:
+ *    - filename: dataset the partition was computed on.
+ *    - delta:    edge delta file.
+ *    - partfile: previous partition, as written by PartitionToTSV or
+ *                PartitionToBIN.
+ */
+void run_incremental(string filename, string delta, string partfile) {
+  vector<double>       arrv;
+  vector<Community>    univ;
+  MaxHeap              heap;
+  Graph                g;
+
+#ifdef OUTPUT
+  cout << "============================================================\n";
+  cout << "CNM-incremental\n\n";
+#endif
+  stats_reset();
+  vector<vid_t> own, touched;
+  {
+    ScopedTimer timer(T_PARSE);
+    load_graph(g, filename);
+    own = LoadPartition(partfile, g.n);
+    if (!g.apply_delta(delta, touched)) {
+      cerr << "Error opening delta file\n";
+      exit(1);
+    }
+  }
+
+  auto begin = chrono::steady_clock::now();
+  vid_t dirty;
+  {
+    ScopedTimer timer(T_BUILD);
+    dirty = init_incremental(univ, arrv, g, own, touched);
+  }
+  init_heap(heap, univ, arrv);
+  double sQ;
+  tie(ignore, sQ) = cnm(modularity(g, labels(univ, arrv)), univ, arrv, heap);
+  double Q;
+  {
+    ScopedTimer timer(T_POST);
+    own = labels(univ, arrv);
+    Q = modularity(g, own);
+  }
+  double total_time = since(begin);
+
+  {
+    ScopedTimer timer(T_OUTPUT);
+    for (vid_t v=0; v<own.size(); v++)
+      if (g.degree(v) == 0) own[v] = -1;
+    PartitionToTSV(filename, "inc", own);
+    PartitionToBIN(filename, "inc", own, Q);
+    SizeToTSV(filename, "inc", univ, arrv, g.m);
+
+    ofstream myfile;
+    myfile.open ("summary_" + filename, ios::app);
+    myfile << "CNM-incremental  delta: " << delta << " ";
+    myfile << "Q " << Q << " total_time " << total_time << "\n";
+    myfile.close();
+  }
+  stats_close(filename, "CNM-incremental");
+
+#ifdef OUTPUT
+  cout << "# vertices: " << g.n << "\n";
+  cout << "# edges: " << g.m << "\n";
+  cout << "# touched vertices: " << touched.size() << "\n";
+  cout << "# communities dissolved: " << dirty << "\n";
+  cout << "total time: " << total_time << " seconds\n";
+  cout << "Q: " << Q << "\n";
+  cout << "============================================================\n\n";
+#endif
+}
+
+
 /* MAIN */
 int main(int argc, char *argv[]) {
 /* ========================================================================= */
@@ -268,10 +501,9 @@ int main(int argc, char *argv[]) {
 	                               within another. */
 	vector<Community>    univ;  /* Array of Communities. */
 	MaxHeap              heap;  /* Max-Heap of pairs delta Q value. */
-	int                  m;     /* Number of edges */
 /* ========================================================================= */
 	
-	if (argc != 3) {
+	if (argc < 3) {
 		cerr << "Extra Command Line Arguments Error: wrong number of arguments" << endl;
 		exit(1);
 	}
@@ -280,19 +512,81 @@ int main(int argc, char *argv[]) {
 	string filename;
 	ss >> filename;
   
+  // "auto" (or 0) lets cnm2 adapt the scope every round
   istringstream ii(argv[2]);
-  int l_scope;
-  if(!(ii >> l_scope))
+  int l_scope = SCOPE_AUTO;
+  if (string(argv[2]) != "auto" && (!(ii >> l_scope) || l_scope < 0)) {
     cerr << "Invalid number\n";
+    exit(1);
+  }
+
+  // options
+  int threads = 1;
+  uint64_t every = 0;
+  double seconds = 0;
+  bool resume = false;
+  string report;
+  Algorithm algo = CNM_MULTISTEP;
+  string delta, partfile;
+  for (int a=3; a<argc; a++) {
+    string opt(argv[a]);
+    if (opt == "--louvain") {
+      algo = LOUVAIN;
+    } else if (opt == "--incremental" && a+1 < argc) {
+      delta = argv[++a];
+    } else if (opt == "--partition" && a+1 < argc) {
+      partfile = argv[++a];
+    } else if (opt == "--checkpoint" && a+1 < argc) {
+      istringstream it(argv[++a]);
+      if (!(it >> every)) {
+        cerr << "Invalid checkpoint interval\n";
+        exit(1);
+      }
+    } else if (opt == "--checkpoint-time" && a+1 < argc) {
+      istringstream it(argv[++a]);
+      if (!(it >> seconds) || seconds < 0) {
+        cerr << "Invalid checkpoint interval\n";
+        exit(1);
+      }
+    } else if (opt == "--perf") {
+      perf_enable();
+    } else if (opt == "--report" && a+1 < argc) {
+      report = argv[++a];
+    } else if (opt == "--resume") {
+      resume = true;
+    } else if (opt == "--threads" && a+1 < argc) {
+      istringstream it(argv[++a]);
+      if (!(it >> threads) || threads < 1) {
+        cerr << "Invalid number of threads\n";
+        exit(1);
+      }
+    } else {
+      cerr << "Extra Command Line Arguments Error: unknown option " << opt << endl;
+      exit(1);
+    }
+  }
 
 	if (!fileExists(filename)) {
 		cerr << "Extra Command Line Arguments Error: file doesn't exists" << endl;
 		exit(1);
 	}
 
-  bool flag = run(filename, true, l_scope);
+  stats_enable(!report.empty());
+  if (!delta.empty()) {
+    if (partfile.empty()) {
+      partfile = filename + "_part_" + tags[algo] + ".bin";
+      if (!fileExists(partfile)) partfile = filename + "_part_" + tags[algo] + ".tsv";
+    }
+    run_incremental(filename, delta, partfile);
+  } else {
+    bool flag = run(filename, algo, l_scope, threads, every, seconds, resume);
 #ifdef COMP
-  if (flag) run(filename, false, 0);
+    if (flag) run(filename, CNM_STANDARD, 0, 1, every, seconds, resume);
 #endif
+  }
+  if (!report.empty() && !stats_report(report)) {
+    cerr << "Error writing report file\n";
+    exit(1);
+  }
   exit(0);
 }
@@ -0,0 +1,113 @@
+/* ===========================================================================
+ * part.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ===========================================================================
+ *
+ * Author: Lorenzo Rutigliano
+ *
+ * ===========================================================================
+ */
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#include "Partition.h"
+#include "Writer.h"
+using namespace std;
+
+/* ============================================================================
+ * fcd-part: read a binary partition, as written in dataset_part_<tag>.bin.
+ *
+ *    ./fcd-part file.bin [summary | vertex V | community C | tsv OUT]
+ *
+ * summary prints the header and the largest communities, vertex and
+ * community query the index, tsv exports the partition in the format of
+ * dataset_part_<tag>.tsv.
+ * ============================================================================
+ */
+
+#define USAGE "usage: fcd-part file.bin [summary | vertex V | community C | tsv OUT]\n"
+
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << USAGE;
+    exit(1);
+  }
+  string mode = (argc > 2) ? argv[2] : "summary";
+  long long arg = -1;
+  if (mode == "vertex" || mode == "community") {
+    istringstream ia((argc > 3) ? argv[3] : "");
+    if (!(ia >> arg)) {
+      cerr << USAGE;
+      exit(1);
+    }
+  } else if ((mode == "tsv" && argc < 4) || (mode != "tsv" && mode != "summary")) {
+    cerr << USAGE;
+    exit(1);
+  }
+
+  auto begin = chrono::steady_clock::now();
+  Partition p;
+  if (!p.load(argv[1])) {
+    cerr << "Error reading partition " << argv[1] << "\n";
+    exit(1);
+  }
+  double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+  if (mode == "summary") {
+    uint64_t entries = p.offsets[p.communities];
+    cout << "# vertices: " << p.n << "\n";
+    cout << "# assigned: " << entries << "\n";
+    cout << "# communities: " << p.communities << "\n";
+    cout << "Q: " << p.Q << "\n";
+    cout << "load time: " << elapsed << " seconds\n";
+    vector<vid_t> order(p.communities);
+    for (vid_t c=0; c<p.communities; c++) order[c] = c;
+    size_t top = min<size_t>(order.size(), 10);
+    partial_sort(order.begin(), order.begin() + top, order.end(),
+      [&](vid_t a, vid_t b) {return p.size(a) > p.size(b);});
+    for (size_t i=0; i<top; i++)
+      cout << "community " << p.ids[order[i]] << "\tsize " << p.size(order[i]) << "\n";
+  } else if (mode == "vertex") {
+    if (arg < 0 || arg >= p.n) {
+      cerr << "Vertex out of range\n";
+      exit(1);
+    }
+    cout << p.membership[arg] << "\n";
+  } else if (mode == "community") {
+    vid_t c = (arg >= 0 && arg < p.n) ? p.find(arg) : -1;
+    if (c < 0) {
+      cerr << "No community " << arg << "\n";
+      exit(1);
+    }
+    for (uint64_t i=p.offsets[c]; i<p.offsets[c+1]; i++)
+      cout << p.members[i] << "\n";
+  } else {
+    TsvWriter out(argv[3]);
+    out << "Id\tCommunity\n";
+    for (vid_t v=0; v<p.n; v++)
+      if (p.membership[v] >= 0)
+        out << v << '\t' << p.membership[v] << '\n';
+    if (!out.close()) {
+      cerr << "Error writing " << argv[3] << "\n";
+      exit(1);
+    }
+  }
+  return 0;
+}